@@ -1,143 +1,853 @@
 #include <bits/stdc++.h>
+#include "kendokuOrtak.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 using namespace std;
 
+static const int MIN_N=3, MAX_N=16;
+// at most this many futoshiki relations on an n x n grid: one per
+// side-by-side pair, twice over
+constexpr int MAX_REL(int n){ return 4*n*(n-1); }
+
+// Value tuples of one cage, packed row-major: size() rows of k digits.
+// Cages with the same target and the same pattern of cells sharing a line
+// have identical tuples, so they point at one table. For the compact-table
+// propagator, support(i,d) is the bitset of tuples whose cell i holds digit
+// d+1, in words 64-bit words, and column(i) is cell i's digit-1 for every
+// tuple as one byte each (structure of arrays, padded to whole words).
+struct Table{
+    int k=0, words=0;
+    vector<uint8_t> v, soa;
+    vector<uint64_t> sup;
+    size_t size() const { return k ? v.size()/k : 0; }
+    const uint8_t* row(size_t i) const { return &v[i*k]; }
+    const uint64_t* support(int i, int d) const { return &sup[((size_t)i*MAX_N+d)*words]; }
+    const uint8_t* column(int i) const { return &soa[(size_t)i*words*64]; }
+
+    void index_tuples(){
+        words=(size()+63)/64;
+        sup.assign((size_t)k*MAX_N*words,0);
+        soa.assign((size_t)k*words*64,0);
+        for(size_t t=0;t<size();++t)
+            for(int i=0;i<k;++i){
+                sup[((size_t)i*MAX_N+row(t)[i]-1)*words+t/64] |= 1ull<<(t%64);
+                soa[(size_t)i*words*64+t]=row(t)[i]-1;
+            }
+    }
+};
+
+// For each listed word w of tab, bit t of out[] is set when every cell i
+// of tuple 64w+t holds a digit allowed by dom[i]. Bits past the last tuple
+// are garbage; the live bitset never has them set.
+void tuple_words_scalar(const Table& tab, const unsigned* dom, const int* ws, int cnt, uint64_t* out){
+    for(int p=0;p<cnt;++p){
+        uint64_t ok=~0ull;
+        for(int i=0;i<tab.k;++i){
+            const uint8_t* col=tab.column(i)+(size_t)ws[p]*64;
+            uint64_t bits=0;
+            for(int t=0;t<64;++t) bits|=(uint64_t)(dom[i]>>col[t]&1)<<t;
+            ok&=bits;
+        }
+        out[p]=ok;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Same, 32 tuples per step: each cell's mask becomes a 16-entry byte table
+// and pshufb looks up the digits of 32 tuples at once
+__attribute__((target("avx2")))
+void tuple_words_avx2(const Table& tab, const unsigned* dom, const int* ws, int cnt, uint64_t* out){
+    __m256i lut[32];
+    for(int i=0;i<tab.k;++i){
+        alignas(16) uint8_t b[16];
+        for(int d=0;d<16;++d) b[d] = dom[i]>>d&1 ? 0xFF : 0;
+        lut[i]=_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)b));
+    }
+    for(int p=0;p<cnt;++p){
+        uint64_t ok=0;
+        for(int half=0;half<2;++half){
+            __m256i acc=_mm256_set1_epi8(-1);
+            for(int i=0;i<tab.k;++i){
+                __m256i dg=_mm256_loadu_si256((const __m256i*)(tab.column(i)+(size_t)ws[p]*64+half*32));
+                acc=_mm256_and_si256(acc,_mm256_shuffle_epi8(lut[i],dg));
+            }
+            ok|=(uint64_t)(uint32_t)_mm256_movemask_epi8(acc)<<(32*half);
+        }
+        out[p]=ok;
+    }
+}
+#endif
+
+// a cage visit rescans its live tuples once the incremental update would
+// OR in more than this many support rows per cage cell
+static const int CT_RESCAN=2;
+
+// picked once at startup from what the CPU supports; this runs as a static
+// initializer, possibly before libgcc's own CPU probe, hence the explicit init
+auto tuple_words = []{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) return &tuple_words_avx2;
+#endif
+    return &tuple_words_scalar;
+}();
+
+// ctOff/idxOff/resOff place the cage's compact-table state in State
 struct Cage{
     int target;
     vector<pair<int,int>> cells;
-    vector<vector<int>> combos;
+    shared_ptr<const Table> combos={};
+    int ctOff=0, idxOff=0, resOff=0;
 };
 
-int N=6;
-vector<Cage> cages;
+// The loaded puzzle. Per thread, so generator workers each hold their own;
+// count() hands its puzzle on to the pool threads it starts.
+thread_local int n=6;                // grid size
+thread_local vector<Cage> cages;
+thread_local vector<int> cell_cage;  // r*n+c -> index of the cage holding that cell, or -1
+// futoshiki relations as (greater cell, smaller cell), cells as r*n+c, and
+// per cell the relations it takes part in
+thread_local vector<pair<int,int>> relations;
+thread_local vector<vector<int>> cell_rel;
+
+int pc(unsigned x){ return __builtin_popcount(x); }
+int lowv(unsigned m){ return __builtin_ctz(m)+1; }
 
-int pc(int x){ return __builtin_popcount((unsigned)x); }
-int lowv(int m){ return __builtin_ctz((unsigned)m)+1; }
+// Digit tuples over k cells where cells i and j must differ whenever bit j
+// of clash[i] is set (j<i, the two share a row or column). Digits are
+// tried only while accept(i, v, t) holds; emit(t) gets every full tuple.
+template<class A, class E>
+void enum_tuples(int from, int to, const vector<int>& clash, vector<int>& t, A accept, E emit){
+    function<void(int)> rec=[&](int i){
+        if(i==to){ emit(t); return; }
+        for(int v=1; v<=n; ++v){
+            bool bad=false;
+            for(int j=from;j<i && !bad;++j) bad = (clash[i]>>j&1) && t[j]==v;
+            if(bad || !accept(i,v)) continue;
+            t[i]=v; rec(i+1);
+        }
+    };
+    rec(from);
+}
+
+// Tuples summing to target: each digit must leave a remainder the rest of
+// the cells can still reach with digits 1..n
+void sum_tuples(int k, int target, const vector<int>& clash, vector<uint8_t>& out){
+    vector<int> t(k,0), rem(k+1);
+    rem[0]=target;
+    enum_tuples(0,k,clash,t,
+        [&](int i, int v){
+            int r=rem[i]-v, left=k-1-i;
+            if(r<left || r>left*n) return false;
+            rem[i+1]=r;
+            return true;
+        },
+        [&](const vector<int>& tt){ for(int v:tt) out.push_back(v); });
+}
+
+// Tuples multiplying to target, met in the middle: first-half tuples are
+// bucketed by product p, and a second-half tuple with product q joins the
+// bucket target/q. Every digit must divide what is left of the target.
+// Tuples that also sum to target are skipped, sum_tuples has them.
+void product_tuples(int k, int target, const vector<int>& clash, vector<uint8_t>& out){
+    if(target<1) return;
+    int h=k/2;
+    vector<int> t(k,0);
+    vector<long long> rest(k+1);   // target over the digits placed so far in this half
+    auto divides=[&](int i, int v){
+        if(rest[i]%v) return false;
+        rest[i+1]=rest[i]/v;
+        return true;
+    };
+    unordered_map<long long, vector<int>> left;
+    rest[0]=target;
+    enum_tuples(0,h,clash,t,divides,[&](const vector<int>& tt){
+        auto& b=left[target/rest[h]];
+        b.insert(b.end(),tt.begin(),tt.begin()+h);
+    });
+    rest[h]=target;
+    enum_tuples(h,k,clash,t,divides,[&](const vector<int>& tt){
+        auto it=left.find(rest[k]);
+        if(it==left.end()) return;
+        const vector<int>& b=it->second;
+        for(size_t o=0;o<b.size();o+=h){
+            bool bad=false;
+            int sum=0;
+            for(int j=h;j<k;++j){
+                sum+=tt[j];
+                for(int i=0;i<h && !bad;++i) bad = (clash[j]>>i&1) && b[o+i]==tt[j];
+            }
+            for(int i=0;i<h;++i) sum+=b[o+i];
+            if(bad || sum==target) continue;
+            out.insert(out.end(),b.begin()+o,b.begin()+o+h);
+            out.insert(out.end(),tt.begin()+h,tt.end());
+        }
+    });
+}
 
 void build_combos(Cage& cg){
+    static thread_local map<tuple<int,int,vector<int>>, shared_ptr<const Table>> shared;
     int k=cg.cells.size();
-    cg.combos.clear();
-    if(k==1){
-        if(1<=cg.target && cg.target<=6) cg.combos.push_back({cg.target});
-        return;
-    }
-    if(k==2){
-        for(int a=1;a<=6;++a) for(int b=1;b<=6;++b){
-            if(a+b==cg.target || abs(a-b)==cg.target || a*b==cg.target || (max(a,b)%min(a,b)==0 && max(a,b)/min(a,b)==cg.target))
-                cg.combos.push_back({a,b});
+    vector<int> clash(k,0);
+    for(int i=0;i<k;++i) for(int j=0;j<i;++j)
+        if(cg.cells[i].first==cg.cells[j].first || cg.cells[i].second==cg.cells[j].second) clash[i]|=1<<j;
+    auto& slot=shared[{n,cg.target,clash}];
+    if(!slot){
+        auto tab=make_shared<Table>();
+        tab->k=k;
+        if(k==1){
+            if(1<=cg.target && cg.target<=n) tab->v.push_back(cg.target);
+        } else if(k==2){
+            for(int a=1;a<=n;++a) for(int b=1;b<=n;++b){
+                if(clash[1] && a==b) continue;
+                if(a+b==cg.target || abs(a-b)==cg.target || a*b==cg.target || (max(a,b)%min(a,b)==0 && max(a,b)/min(a,b)==cg.target)){
+                    tab->v.push_back(a); tab->v.push_back(b);
+                }
+            }
+        } else {
+            sum_tuples(k,cg.target,clash,tab->v);
+            product_tuples(k,cg.target,clash,tab->v);
         }
-        return;
+        tab->index_tuples();
+        slot=tab;
     }
-    vector<int> t(k,1);
-    function<void(int)> dfs=[&](int i){
-        if(i==k){
-            int s=0; long long p=1;
-            for(int v:t){ s+=v; p*=v; }
-            if(s==cg.target || p==cg.target) cg.combos.push_back(t);
-            return;
-        }
-        for(int v=1; v<=6; ++v){ t[i]=v; dfs(i+1); }
-    };
-    dfs(0);
+    cg.combos=slot;
 }
 
-struct State{
-    int mask[6][6];
-    int rowUsed[6], colUsed[6];
+// count mode: solutions found so far, where to stop (0 = never) and, if
+// keep is set, the first limit solutions as row-major grids
+struct Tally{
+    atomic<long long> found{0};
+    long long limit=0;
+    vector<vector<int>>* keep=nullptr;
+    mutex mu;
+    bool full() const { return limit && found.load(memory_order_relaxed)>=limit; }
 };
 
-bool propagate(State& st){
-    bool changed=true;
-    while(changed){
-        changed=false;
-        for(int r=0;r<6;++r) for(int c=0;c<6;++c){
-            if(pc(st.mask[r][c])==1) continue;
-            int m = st.mask[r][c];
-            m &= ~st.rowUsed[r];
-            m &= ~st.colUsed[c];
-            if(m==0) return false;
-            if(m!=st.mask[r][c]){ st.mask[r][c]=m; changed=true; }
+// smallest unsigned word holding N candidate bits
+template<int N>
+using MaskFor = typename conditional<(N<=8), uint8_t,
+                typename conditional<(N<=16), uint16_t, uint32_t>::type>::type;
+
+// One solver per grid size; N is a constant so the line loops unroll
+template<int N>
+struct Engine{
+    typedef MaskFor<N> Mask;
+    static constexpr Mask FULL=(Mask)((1u<<N)-1);
+
+    // Masks plus the compact-table state of every cage, with undo trails
+    // of (word, old value): every change goes through set(), and undo()
+    // rolls back to an earlier mark(). Per cage, ct holds the live word
+    // count, the cell masks seen at its last visit and its tuple bitset;
+    // ctIndex lists the bitset words, live ones first; ctRes caches, per
+    // cell and digit, a word that last held a support (a hint, not undone).
+    struct State{
+        Mask mask[N][N];
+        Mask rowUsed[N], colUsed[N];
+        vector<uint64_t> ct;
+        vector<int> ctIndex, ctRes;
+        vector<pair<Mask*,Mask>> trail;
+        vector<pair<uint64_t*,uint64_t>> ctTrail;
+        struct Mark{ size_t masks, words; };
+
+        State(){ trail.reserve(4*N*N); }
+        // a copy starts with empty trails; the source's entries point into the source
+        State(const State& o): ct(o.ct), ctIndex(o.ctIndex), ctRes(o.ctRes){
+            memcpy(mask,o.mask,sizeof mask);
+            memcpy(rowUsed,o.rowUsed,sizeof rowUsed);
+            memcpy(colUsed,o.colUsed,sizeof colUsed);
+            trail.reserve(4*N*N);
         }
-        for(auto& cg:cages){
-            int k=cg.cells.size();
-            vector<int> allow(k,0);
-            for(auto &comb:cg.combos){
-                bool ok=true;
-                for(int i=0;i<k;++i){
-                    int r=cg.cells[i].first, c=cg.cells[i].second;
-                    if(!(st.mask[r][c] & (1<<(comb[i]-1)))){ ok=false; break; }
+        State& operator=(const State&)=delete;
+
+        void set(Mask& w, Mask v){ trail.push_back({&w,w}); w=v; }
+        void set(uint64_t& w, uint64_t v){ ctTrail.push_back({&w,w}); w=v; }
+        Mark mark() const { return {trail.size(), ctTrail.size()}; }
+        void undo(Mark h){
+            while(trail.size()>h.masks){ *trail.back().first=trail.back().second; trail.pop_back(); }
+            while(ctTrail.size()>h.words){ *ctTrail.back().first=ctTrail.back().second; ctTrail.pop_back(); }
+        }
+    };
+
+    // Constraint ids: row r is r, column c is N+c, cage i is 2N+i and
+    // relation j is 2N+cages+j. A constraint is queued only when a mask of
+    // one of its cells changed, and a changed cell wakes just its own row,
+    // column, cage and relations. seed is the cell fixed by the last branch,
+    // or -1 to start with everything queued.
+    static bool propagate(State& st, int seed){
+        const int C=cages.size(), K=2*N+C+relations.size(), CAP=2*N+N*N+MAX_REL(N);
+        int q[CAP], head=0, len=0;
+        bool queued[CAP]={};
+        auto push=[&](int k){
+            if(queued[k]) return;
+            queued[k]=true;
+            q[(head+len++)%CAP]=k;
+        };
+        auto touch=[&](int r, int c){
+            push(r); push(N+c);
+            if(cell_cage[r*N+c]>=0) push(2*N+cell_cage[r*N+c]);
+            for(int j:cell_rel[r*N+c]) push(2*N+C+j);
+        };
+        if(seed<0) for(int k=0;k<K;++k) push(k);
+        else touch(seed/N, seed%N);
+
+        // latin rule on one line: placed digits leave the other cells and a
+        // digit with a single home is placed there
+        auto line=[&](int idx, bool isRow)->bool{
+            Mask* cell = isRow ? &st.mask[idx][0] : &st.mask[0][idx];
+            const int stride = isRow ? 1 : N;
+            auto wake=[&](int i){ if(isRow) touch(idx,i); else touch(i,idx); };
+            Mask placed=0;
+#pragma GCC unroll 16
+            for(int i=0;i<N;++i){
+                Mask m=cell[i*stride];
+                if(pc(m)==1){ if(placed&m) return false; placed|=m; }
+            }
+            Mask& used = isRow ? st.rowUsed[idx] : st.colUsed[idx];
+            if(used!=placed) st.set(used,placed);
+#pragma GCC unroll 16
+            for(int i=0;i<N;++i){
+                Mask& m=cell[i*stride];
+                if(pc(m)==1) continue;
+                Mask nm=m&~placed;
+                if(nm==0) return false;
+                if(nm!=m){ st.set(m,nm); wake(i); }
+            }
+            for(int d=0; d<N; ++d){
+                Mask b=1u<<d;
+                if(placed&b) continue;
+                int cnt=0,pos=-1;
+#pragma GCC unroll 16
+                for(int i=0;i<N;++i) if(cell[i*stride]&b){ cnt++; pos=i; }
+                if(cnt==0) return false;
+                if(cnt==1 && cell[pos*stride]!=b){ st.set(cell[pos*stride],b); wake(pos); }
+            }
+            return true;
+        };
+
+        // compact table: first drop the tuples that lost a value since the
+        // last visit, then keep only the values that still have a live tuple
+        auto cage=[&](int ci)->bool{
+            const Cage& cg=cages[ci];
+            const Table& tab=*cg.combos;
+            const int k=tab.k;
+            uint64_t& live=st.ct[cg.ctOff];
+            uint64_t* last=&st.ct[cg.ctOff+1];
+            uint64_t* cur=last+k;
+            int* index=&st.ctIndex[cg.idxOff];
+            int* res=&st.ctRes[cg.resOff];
+            if(live==0) return false;
+
+            int changed[N*N], nc=0, work=0;
+            Mask dom[N*N];
+            bool viaRemoved[N*N];
+            for(int i=0;i<k;++i){
+                dom[i]=st.mask[cg.cells[i].first][cg.cells[i].second];
+                if(dom[i]==last[i]) continue;
+                // mask the live words with the smaller of the removed values' and
+                // the kept values' support unions
+                int gone=pc(last[i]&~dom[i]);
+                viaRemoved[nc]=gone<pc(dom[i]);
+                work+=min(gone,pc(dom[i]));
+                changed[nc++]=i;
+            }
+            if(nc && work>CT_RESCAN*k){
+                // many values went at once: rescan the live tuples against all
+                // cell masks instead, 32 tuples per step where AVX2 is there
+                static thread_local vector<uint64_t> valid;
+                unsigned udom[N*N];
+                for(int i=0;i<k;++i) udom[i]=dom[i];
+                valid.resize(live);
+                tuple_words(tab,udom,index,live,valid.data());
+                for(int p=(int)live-1;p>=0;--p){
+                    int w=index[p];
+                    uint64_t keep=cur[w]&valid[p];
+                    if(keep==cur[w]) continue;
+                    st.set(cur[w],keep);
+                    if(!keep){ swap(index[p],index[live-1]); st.set(live,live-1); }
+                }
+            }
+            else if(nc){
+                for(int p=(int)live-1;p>=0;--p){
+                    int w=index[p];
+                    uint64_t keep=cur[w];
+                    for(int j=0;j<nc && keep;++j){
+                        int i=changed[j];
+                        uint64_t u=0;
+                        Mask vals = viaRemoved[j] ? Mask(last[i]&~dom[i]) : dom[i];
+                        for(Mask b=vals;b;b&=b-1) u|=tab.support(i,__builtin_ctz(b))[w];
+                        keep &= viaRemoved[j] ? ~u : u;
+                    }
+                    if(keep==cur[w]) continue;
+                    st.set(cur[w],keep);
+                    if(!keep){ swap(index[p],index[live-1]); st.set(live,live-1); }
                 }
-                if(!ok) continue;
-                for(int i=0;i<k;++i) allow[i] |= 1<<(comb[i]-1);
+            }
+            if(nc){
+                if(live==0) return false;
+                for(int j=0;j<nc;++j) st.set(last[changed[j]],(uint64_t)dom[changed[j]]);
             }
             for(int i=0;i<k;++i){
-                int r=cg.cells[i].first, c=cg.cells[i].second;
-                int m = st.mask[r][c] & allow[i];
+                Mask m=dom[i];
+                for(Mask b=dom[i];b;b&=b-1){
+                    int d=__builtin_ctz(b);
+                    const uint64_t* sp=tab.support(i,d);
+                    int& r=res[i*MAX_N+d];
+                    if(cur[r]&sp[r]) continue;
+                    int p=0;
+                    while(p<(int)live && !(cur[index[p]]&sp[index[p]])) ++p;
+                    if(p<(int)live) r=index[p];
+                    else m&=~(Mask)(1u<<d);
+                }
                 if(m==0) return false;
-                if(m!=st.mask[r][c]){ st.mask[r][c]=m; changed=true; }
+                if(m==dom[i]) continue;
+                int r=cg.cells[i].first, c=cg.cells[i].second;
+                st.set(st.mask[r][c],m);
+                st.set(last[i],(uint64_t)m);
+                // the table already agrees with m, so only the lines and
+                // relations wake up
+                push(r); push(N+c);
+                for(int j:cell_rel[r*N+c]) push(2*N+C+j);
             }
+            return true;
+        };
+
+        // a > b: a keeps digits above b's lowest, b digits below a's highest
+        auto relation=[&](int j)->bool{
+            int a=relations[j].first, b=relations[j].second;
+            Mask& ma=st.mask[a/N][a%N];
+            Mask& mb=st.mask[b/N][b%N];
+            Mask na=ma & (Mask)~((2u<<__builtin_ctz(mb))-1);
+            if(na==0) return false;
+            if(na!=ma){ st.set(ma,na); touch(a/N,a%N); }
+            Mask nb=mb & (Mask)((1u<<(31-__builtin_clz(na)))-1);
+            if(nb==0) return false;
+            if(nb!=mb){ st.set(mb,nb); touch(b/N,b%N); }
+            return true;
+        };
+
+        while(len){
+            int k=q[head]; head=(head+1)%CAP; --len;
+            queued[k]=false;
+            bool ok = k<N ? line(k,true) : k<2*N ? line(k-N,false) : k<2*N+C ? cage(k-2*N) : relation(k-2*N-C);
+            if(!ok) return false;
         }
-        for(int r=0;r<6;++r){
-            for(int c=0;c<6;++c){
-                if(pc(st.mask[r][c])==1){
-                    int v=lowv(st.mask[r][c]);
-                    if(!(st.rowUsed[r]&(1<<(v-1)))){ st.rowUsed[r]|=1<<(v-1); changed=true; }
-                    if(!(st.colUsed[c]&(1<<(v-1)))){ st.colUsed[c]|=1<<(v-1); changed=true; }
-                }
+        return true;
+    }
+
+    static bool solved(const State& st){
+        for(int r=0;r<N;++r) for(int c=0;c<N;++c) if(pc(st.mask[r][c])!=1) return false;
+        return true;
+    }
+
+    // unfixed cell with the fewest candidates, as r*N+c
+    static int pick_cell(const State& st){
+        int cell=-1, best=N+1;
+        for(int r=0;r<N;++r) for(int c=0;c<N;++c){
+            int p=pc(st.mask[r][c]);
+            if(p>1 && p<best){ best=p; cell=r*N+c; }
+        }
+        return cell;
+    }
+
+    static void assign(State& st, int br, int bc, int d){
+        Mask b=1u<<(d-1);
+        st.set(st.mask[br][bc],b);
+        st.set(st.rowUsed[br],st.rowUsed[br]|b);
+        st.set(st.colUsed[bc],st.colUsed[bc]|b);
+    }
+
+    // st is already propagated; each branch only wakes the constraints of
+    // the cell it fixed and is rolled back through the trail
+    static bool dfs(State& st){
+        if(solved(st)) return true;
+        int cell=pick_cell(st), br=cell/N, bc=cell%N;
+        Mask m=st.mask[br][bc];
+        for(int d=1; d<=N; ++d) if(m&(1u<<(d-1))){
+            auto h=st.mark();
+            assign(st,br,bc,d);
+            if(propagate(st,cell) && dfs(st)) return true;
+            st.undo(h);
+        }
+        return false;
+    }
+
+    static void found(const State& st, Tally& tl){
+        long long k=tl.found++;
+        if(!tl.keep || k>=tl.limit) return;
+        vector<int> g(N*N);
+        for(int r=0;r<N;++r) for(int c=0;c<N;++c) g[r*N+c]=lowv(st.mask[r][c]);
+        lock_guard<mutex> lk(tl.mu);
+        tl.keep->push_back(g);
+    }
+
+    static void count_from(State& st, Tally& tl){
+        if(tl.full()) return;
+        if(solved(st)){ found(st,tl); return; }
+        int cell=pick_cell(st), br=cell/N, bc=cell%N;
+        Mask m=st.mask[br][bc];
+        for(int d=1; d<=N; ++d) if(m&(1u<<(d-1))){
+            auto h=st.mark();
+            assign(st,br,bc,d);
+            if(propagate(st,cell)) count_from(st,tl);
+            st.undo(h);
+        }
+    }
+
+    // cuts the tree `depth` levels below st into independent subtrees
+    static void split(State& st, int depth, vector<State>& out, Tally& tl){
+        if(solved(st)){ found(st,tl); return; }
+        if(depth==0){ out.push_back(st); return; }
+        int cell=pick_cell(st), br=cell/N, bc=cell%N;
+        Mask m=st.mask[br][bc];
+        for(int d=1; d<=N; ++d) if(m&(1u<<(d-1))){
+            auto h=st.mark();
+            assign(st,br,bc,d);
+            if(propagate(st,cell)) split(st,depth-1,out,tl);
+            st.undo(h);
+        }
+    }
+
+    static State initial(){
+        State st;
+        for(int r=0;r<N;++r){ st.rowUsed[r]=st.colUsed[r]=0; for(int c=0;c<N;++c) st.mask[r][c]=FULL; }
+        for(auto& cg:cages){
+            const Table& tab=*cg.combos;
+            st.ct.push_back(tab.words);
+            st.ct.insert(st.ct.end(),tab.k,FULL);
+            for(int w=0;w<tab.words;++w){
+                int bits=min<size_t>(64,tab.size()-64*w);
+                st.ct.push_back(bits==64 ? ~0ull : (1ull<<bits)-1);
+                st.ctIndex.push_back(w);
             }
         }
-        for(int r=0;r<6;++r){
-            for(int d=1; d<=6; ++d){
-                if(st.rowUsed[r]&(1<<(d-1))) continue;
-                int cnt=0,pos=-1;
-                for(int c=0;c<6;++c) if(st.mask[r][c]&(1<<(d-1))){ cnt++; pos=c; }
-                if(cnt==0) return false;
-                if(cnt==1){
-                    int c=pos; int m=1<<(d-1);
-                    if(st.mask[r][c]!=m){ st.mask[r][c]=m; changed=true; }
-                }
+        st.ctRes.assign(cages.empty() ? 0 : cages.back().resOff+cages.back().cells.size()*MAX_N,0);
+        return st;
+    }
+
+    // solutions up to limit (0 = all, 2 = uniqueness), subtrees below
+    // split_depth spread over a work-stealing pool; keep collects them
+    static long long count(long long limit, int split_depth, int threads, vector<vector<int>>* keep=nullptr){
+        Tally tl;
+        tl.limit=limit; tl.keep=keep;
+        State root=initial();
+        vector<State> tasks;
+        if(propagate(root,-1)) split(root,split_depth,tasks,tl);
+        int pn=n;
+        const vector<Cage>& pc=cages;
+        const vector<int>& pcell=cell_cage;
+        const vector<pair<int,int>>& prel=relations;
+        const vector<vector<int>>& pcrel=cell_rel;
+        runStealing(tasks,threads,[&](State& st){
+            if(cell_cage.empty()){ n=pn; cages=pc; cell_cage=pcell; relations=prel; cell_rel=pcrel; }
+            count_from(st,tl);
+        });
+        return limit ? min(tl.found.load(),limit) : tl.found.load();
+    }
+
+    static bool solve(vector<vector<int>>& grid){
+        State st=initial();
+        if(!propagate(st,-1) || !dfs(st)) return false;
+        grid.assign(N, vector<int>(N));
+        for(int r=0;r<N;++r) for(int c=0;c<N;++c) grid[r][c]=lowv(st.mask[r][c]);
+        return true;
+    }
+};
+
+// runtime size -> Engine<N>, handed to f
+template<int N, class F>
+bool with_engine(F f){
+    if constexpr(N>MAX_N) return false;
+    else{
+        if(n!=N) return with_engine<N+1>(f);
+        f(Engine<N>());
+        return true;
+    }
+}
+
+// Tuple tables, the cell -> cage and cell -> relation indexes and the
+// compact-table offsets
+void prepare(){
+    for(auto& cg:cages) build_combos(cg);
+    cell_rel.assign(n*n,{});
+    for(int j=0;j<(int)relations.size();++j){
+        cell_rel[relations[j].first].push_back(j);
+        cell_rel[relations[j].second].push_back(j);
+    }
+    cell_cage.assign(n*n,-1);
+    int ct=0, idx=0, res=0;
+    for(int i=0;i<(int)cages.size();++i){
+        Cage& cg=cages[i];
+        for(auto& p:cg.cells) cell_cage[p.first*n+p.second]=i;
+        cg.ctOff=ct; cg.idxOff=idx; cg.resOff=res;
+        ct+=1+cg.cells.size()+cg.combos->words;
+        idx+=cg.combos->words;
+        res+=cg.cells.size()*MAX_N;
+    }
+}
+
+// ---- dancing links ----
+
+// Exact cover with primary columns for cell (r,c), digit d in row r and
+// digit d in column c. A DLX row is one whole cage assignment taken from
+// the cage's tuple table (a cell outside every cage gets one row per
+// digit), so the latin rules and the cages are covered in one structure.
+// Futoshiki relations are checked when a row is tried. Links are index
+// arrays: node 0 is the root, nodes 1..3n^2 the column headers.
+struct Dlx{
+    vector<int> L,R,U,D,col,rowOf,size;
+    vector<vector<pair<int,int>>> rowCells;   // (cell, digit) placed by each row
+    vector<int> grid;                         // placed digit per cell, 0 = open
+    long long nodes=0, found=0, limit=0;
+    vector<int> first;                        // first solution, row-major
+
+    int node(int c){
+        int x=L.size();
+        L.push_back(x); R.push_back(x); U.push_back(U[c]); D.push_back(c);
+        D[U[c]]=x; U[c]=x;
+        col.push_back(c); rowOf.push_back(rowCells.size());
+        size[c]++;
+        return x;
+    }
+
+    void add_row(const vector<pair<int,int>>& cells){
+        int head=-1;
+        for(auto [cell,d]:cells){
+            int r=cell/n, c=cell%n;
+            for(int cc:{1+cell, 1+n*n+r*n+d-1, 1+2*n*n+c*n+d-1}){
+                int x=node(cc);
+                if(head<0){ head=x; continue; }
+                L[x]=L[head]; R[x]=head; R[L[head]]=x; L[head]=x;
             }
         }
-        for(int c=0;c<6;++c){
-            for(int d=1; d<=6; ++d){
-                if(st.colUsed[c]&(1<<(d-1))) continue;
-                int cnt=0,pos=-1;
-                for(int r=0;r<6;++r) if(st.mask[r][c]&(1<<(d-1))){ cnt++; pos=r; }
-                if(cnt==0) return false;
-                if(cnt==1){
-                    int r=pos; int m=1<<(d-1);
-                    if(st.mask[r][c]!=m){ st.mask[r][c]=m; changed=true; }
-                }
+        rowCells.push_back(cells);
+    }
+
+    Dlx(){
+        int cols=3*n*n;
+        for(int i=0;i<=cols;++i){
+            L.push_back(i==0 ? cols : i-1); R.push_back(i==cols ? 0 : i+1);
+            U.push_back(i); D.push_back(i); col.push_back(i); rowOf.push_back(-1);
+        }
+        size.assign(cols+1,0);
+        vector<char> caged(n*n,0);
+        for(auto& cg:cages){
+            const Table& tab=*cg.combos;
+            for(auto& p:cg.cells) caged[p.first*n+p.second]=1;
+            for(size_t t=0;t<tab.size();++t){
+                vector<pair<int,int>> cells;
+                for(int i=0;i<tab.k;++i) cells.push_back({cg.cells[i].first*n+cg.cells[i].second, tab.row(t)[i]});
+                add_row(cells);
             }
         }
+        for(int x=0;x<n*n;++x) if(!caged[x]) for(int d=1;d<=n;++d) add_row({{x,d}});
+        grid.assign(n*n,0);
+    }
+
+    void cover(int c){
+        L[R[c]]=L[c]; R[L[c]]=R[c];
+        for(int i=D[c];i!=c;i=D[i]) for(int j=R[i];j!=i;j=R[j]){
+            U[D[j]]=U[j]; D[U[j]]=D[j]; size[col[j]]--;
+        }
+    }
+    void uncover(int c){
+        for(int i=U[c];i!=c;i=U[i]) for(int j=L[i];j!=i;j=L[j]){
+            size[col[j]]++; U[D[j]]=j; D[U[j]]=j;
+        }
+        L[R[c]]=c; R[L[c]]=c;
     }
+
+    // places the row's digits if no relation with a placed cell breaks
+    bool place(int row){
+        for(auto& p:rowCells[row]) grid[p.first]=p.second;
+        for(auto& p:rowCells[row]) for(int j:cell_rel[p.first]){
+            int a=grid[relations[j].first], b=grid[relations[j].second];
+            if(a && b && a<=b){ unplace(row); return false; }
+        }
+        return true;
+    }
+    void unplace(int row){ for(auto& p:rowCells[row]) grid[p.first]=0; }
+
+    // Algorithm X on the column with the fewest rows; false once the limit is hit
+    bool search(){
+        ++nodes;
+        if(R[0]==0){
+            if(found++==0) first=grid;
+            return !(limit && found>=limit);
+        }
+        int c=R[0];
+        for(int j=R[0];j;j=R[j]) if(size[j]<size[c]) c=j;
+        if(size[c]==0) return true;
+        cover(c);
+        bool go=true;
+        for(int r=D[c];r!=c && go;r=D[r]){
+            if(!place(rowOf[r])) continue;
+            for(int j=R[r];j!=r;j=R[j]) cover(col[j]);
+            go=search();
+            for(int j=L[r];j!=r;j=L[j]) uncover(col[j]);
+            unplace(rowOf[r]);
+        }
+        uncover(c);
+        return go;
+    }
+
+    long long count(long long lim){ limit=lim; search(); return limit ? min(found,limit) : found; }
+};
+
+// Puzzle file: grid size, then one cage per line as "target r,c r,c ..."
+// with 0-based cells, and futoshiki relations as "> r,c r,c" (first cell
+// greater) or "< r,c r,c". A cell is in at most one cage; a puzzle of
+// relations only is plain futoshiki. A blank line after the constraints
+// ends the puzzle, so one file can hold several.
+bool read_puzzle(istream& in){
+    if(!(in>>n) || n<MIN_N || n>MAX_N) return false;
+    cages.clear();
+    relations.clear();
+    vector<vector<int>> owner(n, vector<int>(n,0));
+    string line;
+    getline(in,line);
+    while(getline(in,line)){
+        istringstream ls(line);
+        string head;
+        if(!(ls>>head)){ if(cages.empty() && relations.empty()) continue; else break; }
+        if(head[0]=='#') continue;
+        if(head=="<" || head==">"){
+            string a,b;
+            int r1,c1,r2,c2;
+            if(!(ls>>a>>b) || sscanf(a.c_str(),"%d,%d",&r1,&c1)!=2 || sscanf(b.c_str(),"%d,%d",&r2,&c2)!=2) return false;
+            if(r1<0 || r1>=n || c1<0 || c1>=n || r2<0 || r2>=n || c2<0 || c2>=n || (r1==r2 && c1==c2)) return false;
+            if((int)relations.size()==MAX_REL(n)) return false;
+            if(head==">") relations.push_back({r1*n+c1, r2*n+c2});
+            else relations.push_back({r2*n+c2, r1*n+c1});
+            continue;
+        }
+        Cage cg;
+        cg.target=atoi(head.c_str());
+        string cell;
+        while(ls>>cell){
+            int r,c;
+            if(sscanf(cell.c_str(),"%d,%d",&r,&c)!=2 || r<0 || r>=n || c<0 || c>=n) return false;
+            owner[r][c]++;
+            cg.cells.push_back({r,c});
+        }
+        if(cg.cells.empty() || cg.cells.size()>31) return false;
+        cages.push_back(cg);
+    }
+    for(auto& row:owner) for(int k:row) if(k>1) return false;
     return true;
 }
 
-bool solved(const State& st){
-    for(int r=0;r<6;++r) for(int c=0;c<6;++c) if(pc(st.mask[r][c])!=1) return false;
-    return true;
+// ---- generator ----
+
+// loads a generator candidate and counts its solutions, up to two
+long long candidate_solutions(int sz, const vector<GenCage>& gen, vector<vector<int>>& sols){
+    n=sz;
+    cages.clear();
+    for(auto& g:gen) if(!g.cells.empty()) cages.push_back({g.target,g.cells,nullptr});
+    prepare();
+    long long found=0;
+    with_engine<MIN_N>([&](auto e){ found=e.count(2,0,1,&sols); });
+    return found;
 }
 
-bool dfs(State& st){
-    if(!propagate(st)) return false;
-    if(solved(st)) return true;
-    int br=-1, bc=-1, best=10;
-    for(int r=0;r<6;++r) for(int c=0;c<6;++c){
-        int p=pc(st.mask[r][c]);
-        if(p>1 && p<best){ best=p; br=r; bc=c; }
-    }
-    int m=st.mask[br][bc];
-    for(int d=1; d<=6; ++d) if(m&(1<<(d-1))){
-        State nx=st;
-        nx.mask[br][bc]=1<<(d-1);
-        nx.rowUsed[br] |= 1<<(d-1);
-        nx.colUsed[bc] |= 1<<(d-1);
-        if(dfs(nx)){ st=nx; return true; }
-    }
-    return false;
+// the loaded puzzle in the puzzle file format
+void write_puzzle(ostream& os){
+    os<<n<<"\n";
+    for(auto& cg:cages){
+        os<<cg.target;
+        for(auto& p:cg.cells) os<<' '<<p.first<<','<<p.second;
+        os<<"\n";
+    }
+}
+
+// count or solve the loaded puzzle, with the propagation engine or DLX
+void run(long long limit, int depth, int threads, bool dlx){
+    prepare();
+    if(dlx){
+        Dlx x;
+        long long found=x.count(limit>=0 ? limit : 1);
+        if(limit>=0){
+            cout<<"Solutions: "<<found<<(limit && found>=limit ? "+" : "")<<" ("<<x.nodes<<" nodes)\n";
+            if(limit!=1) cout<<(found==0 ? "no solution\n" : found==1 ? "unique\n" : "not unique\n");
+            return;
+        }
+        if(!found){ cout<<"No solution\n"; return; }
+        for(int r=0;r<n;++r){
+            for(int c=0;c<n;++c){
+                if(c) cout<<' ';
+                cout<<x.first[r*n+c];
+            }
+            cout<<"\n";
+        }
+        return;
+    }
+    if(limit>=0){
+        long long found=0;
+        with_engine<MIN_N>([&](auto e){ found=e.count(limit,depth,threads); });
+        cout<<"Solutions: "<<found<<(limit && found>=limit ? "+" : "")<<"\n";
+        if(limit!=1) cout<<(found==0 ? "no solution\n" : found==1 ? "unique\n" : "not unique\n");
+        return;
+    }
+    vector<vector<int>> grid;
+    bool ok=false;
+    with_engine<MIN_N>([&](auto e){ ok=e.solve(grid); });
+    if(!ok){ cout<<"No solution\n"; return; }
+    for(int r=0;r<n;++r){
+        for(int c=0;c<n;++c){
+            if(c) cout<<' ';
+            cout<<grid[r][c];
+        }
+        cout<<"\n";
+    }
 }
 
-int main(){
+// usage: Eki25IslemsizKendoku [-c limit] [-t threads] [-d depth] [puzzle]
+//        Eki25IslemsizKendoku -x [-c limit] [puzzle]
+//        Eki25IslemsizKendoku --generate count [-n size] [-m maxcage] [-s seed] [-t threads] [-o file]
+//   -c count solutions up to limit (0 = all, 2 = uniqueness check)
+//   -t worker threads, -d depth at which the count splits the search
+//   -x use the dancing-links exact-cover engine (single-threaded)
+//   --generate writes count puzzles with exactly one solution
+int main(int argc, char** argv){
+    long long limit=-1;
+    int threads=max(1u, thread::hardware_concurrency()), depth=3;
+    bool dlx=false;
+    const char* path=nullptr;
+    const char* outPath=nullptr;
+    GenOptions gen;
+    for(int i=1;i<argc;++i){
+        bool has=i+1<argc;
+        if(!strcmp(argv[i],"-c") && has) limit=max(0LL, atoll(argv[++i]));
+        else if(!strcmp(argv[i],"-t") && has) threads=max(1, atoi(argv[++i]));
+        else if(!strcmp(argv[i],"-d") && has) depth=max(0, atoi(argv[++i]));
+        else if(!strcmp(argv[i],"-x")) dlx=true;
+        else if(!strcmp(argv[i],"--generate") && has) gen.count=max(0LL, atoll(argv[++i]));
+        else if(!strcmp(argv[i],"-n") && has) gen.size=atoi(argv[++i]);
+        else if(!strcmp(argv[i],"-m") && has) gen.maxCage=min(31, max(1, atoi(argv[++i])));
+        else if(!strcmp(argv[i],"-s") && has) gen.seed=strtoul(argv[++i],nullptr,10);
+        else if(!strcmp(argv[i],"-o") && has) outPath=argv[++i];
+        else path=argv[i];
+    }
+    if(gen.count>0){
+        if(gen.size<MIN_N || gen.size>MAX_N){ cout<<"Size must be "<<MIN_N<<".."<<MAX_N<<"\n"; return 1; }
+        gen.threads=threads;
+        if(!outPath) return generate(gen,cout,candidate_solutions,write_puzzle);
+        ofstream f(outPath);
+        if(!f){ cout<<"Cannot write "<<outPath<<"\n"; return 1; }
+        return generate(gen,f,candidate_solutions,write_puzzle);
+    }
+    if(path){
+        ifstream f(path);
+        int done=0;
+        while(f && read_puzzle(f)){
+            if(done++) cout<<"\n";
+            run(limit,depth,threads,dlx);
+        }
+        if(!done || !f.eof()){ cout<<"Cannot read puzzle "<<path<<"\n"; return 1; }
+        return 0;
+    }
+    n=6;
     cages = {
         {10, {{0,0},{1,0},{1,1}}},        // 1
         { 2, {{0,1},{0,2}}},              // 2
@@ -156,19 +866,6 @@ int main(){
         {11, {{4,4},{5,4}}},              // 15
         { 5, {{4,5},{5,5}}}               // 16
     };
-    for(auto& cg:cages) build_combos(cg);
-    State st;
-    for(int r=0;r<6;++r){ st.rowUsed[r]=0; for(int c=0;c<6;++c) st.mask[r][c]=(1<<6)-1; }
-    for(int c=0;c<6;++c) st.colUsed[c]=0;
-    bool ok=dfs(st);
-    if(!ok){ cout<<"No solution\n"; return 0; }
-    for(int r=0;r<6;++r){
-        for(int c=0;c<6;++c){
-            int v=lowv(st.mask[r][c]);
-            if(c) cout<<' ';
-            cout<<v;
-        }
-        cout<<"\n";
-    }
+    run(limit,depth,threads,dlx);
     return 0;
-}
\ No newline at end of file
+}
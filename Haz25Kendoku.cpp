@@ -1,99 +1,564 @@
 #include <bits/stdc++.h>
+#include "kendokuOrtak.h"
 using namespace std;
 
-enum Op { ADD, SUB, MUL, DIV };
-
 // A “cage” consists of a target number, an operation, and a list of its cells
 struct Cage {
     int target;
     Op op;
     vector<pair<int,int>> cells;
+    vector<vector<int>> combos = {};    // value tuples that reach target under op
+    // support[(i*MAX_N + d-1)*words + w]: bit t set when combo 64w+t puts d
+    // in cell i; liveOff is the cage's first word in Engine::State::live
+    vector<uint64_t> support = {};
+    int words = 0, liveOff = 0;
 };
 
-static const int N = 6;
-vector<Cage> cages;
-int grid[N][N];
-bool rowUsed[N][N+1], colUsed[N][N+1];
-
-// Check that a (possibly partially‐filled) cage still can reach its target
-bool checkCage(const Cage &c, bool finalCheck=false) {
-    vector<int> v;
-    int sum = 0, prod = 1;
-    for (auto &p : c.cells) {
-        int x = grid[p.first][p.second];
-        if (x == 0) {
-            // for ADD/MUL we can do a partial ≤ check; for SUB/DIV wait until filled
-            if (c.op==ADD || c.op==MUL) continue;
-            else return true;
-        }
-        v.push_back(x);
-        sum  += x;
-        prod *= x;
-    }
-    switch(c.op) {
-      case ADD:
-        return finalCheck ? (sum == c.target) : (sum <= c.target);
-      case MUL:
-        return finalCheck ? (prod == c.target) : (prod <= c.target);
+static const int MIN_N = 3, MAX_N = 16;
+// The loaded puzzle, per thread so generator workers each hold their own;
+// count() passes it on to the pool threads it starts
+thread_local int n = 6;             // grid size
+thread_local vector<Cage> cages;
+thread_local vector<int> cageOf;    // cage index per cell, r*n+c
+
+// Does the tuple t reach the cage's target with the cage's own operator?
+bool meetsTarget(const Cage &cg, const vector<int> &t) {
+    switch (cg.op) {
+      case ADD: {
+        int sum = 0;
+        for (int v : t) sum += v;
+        return sum == cg.target;
+      }
+      case MUL: {
+        long long prod = 1;
+        for (int v : t) prod *= v;
+        return prod == cg.target;
+      }
       case SUB:
-        if (v.size() < 2) return true;
-        return abs(v[0] - v[1]) == c.target;
-      case DIV:
-        if (v.size() < 2) return true;
-        {
-          int a = max(v[0],v[1]), b = min(v[0],v[1]);
-          return b>0 && a%b==0 && a/b==c.target;
-        }
+        return t.size() == 2 && abs(t[0] - t[1]) == cg.target;
+      case DIV: {
+        if (t.size() != 2) return false;
+        int a = max(t[0], t[1]), b = min(t[0], t[1]);
+        return a % b == 0 && a / b == cg.target;
+      }
     }
     return false;
 }
 
-// Backtrack in row‐major order
-bool solve(int idx = 0) {
-    if (idx == N*N) {
-        // final validation
-        for (auto &c : cages)
-            if (!checkCage(c, true))
-                return false;
-        return true;
+// All value tuples for the cage under its operator. Cells of the cage that
+// share a row or column must differ, so those tuples are dropped up front.
+void buildCombos(Cage &cg) {
+    int k = cg.cells.size();
+    cg.combos.clear();
+    vector<int> t(k, 1);
+    function<void(int)> rec = [&](int i) {
+        if (i == k) {
+            if (meetsTarget(cg, t)) cg.combos.push_back(t);
+            return;
+        }
+        for (int v = 1; v <= n; ++v) {
+            bool clash = false;
+            for (int j = 0; j < i && !clash; ++j)
+                clash = t[j] == v && (cg.cells[j].first == cg.cells[i].first ||
+                                      cg.cells[j].second == cg.cells[i].second);
+            if (clash) continue;
+            t[i] = v;
+            rec(i + 1);
+        }
+    };
+    rec(0);
+}
+
+// Builds every cage's combos and support bitsets, lays the cages' live
+// words out one after another, and fills the cell -> cage index
+void indexCages() {
+    cageOf.assign(n * n, -1);
+    int off = 0;
+    for (int ci = 0; ci < (int)cages.size(); ++ci) {
+        Cage &cg = cages[ci];
+        buildCombos(cg);
+        int k = cg.cells.size();
+        cg.words = (cg.combos.size() + 63) / 64;
+        cg.support.assign((size_t)k * MAX_N * cg.words, 0);
+        for (size_t t = 0; t < cg.combos.size(); ++t)
+            for (int i = 0; i < k; ++i)
+                cg.support[((size_t)i * MAX_N + cg.combos[t][i] - 1) * cg.words + t / 64] |= 1ull << (t % 64);
+        cg.liveOff = off;
+        off += cg.words;
+        for (auto &p : cg.cells) cageOf[p.first * n + p.second] = ci;
     }
-    int r = idx / N, c = idx % N;
-    if (grid[r][c] != 0)
-        return solve(idx+1);
-
-    for (int d = 1; d <= N; ++d) {
-        if (rowUsed[r][d] || colUsed[c][d]) continue;
-        grid[r][c] = d;
-        rowUsed[r][d] = colUsed[c][d] = true;
-
-        bool ok = true;
-        // only re‐check the cage(s) that include (r,c)
-        for (auto &cg : cages) {
-            for (auto &cell : cg.cells) {
-                if (cell.first==r && cell.second==c) {
-                    if (!checkCage(cg, false)) ok = false;
-                    break;
+}
+
+// Smallest unsigned word with at least N bits
+template <int N>
+using MaskFor = typename conditional<(N <= 8), uint8_t,
+                typename conditional<(N <= 16), uint16_t, uint32_t>::type>::type;
+
+// The solver for one grid size. N is a compile-time constant so every row
+// and column loop has a fixed trip count and unrolls.
+template <int N>
+struct Engine {
+    typedef MaskFor<N> Mask;
+    static constexpr Mask FULL = (Mask)((1u << N) - 1);
+
+    // Candidate bitmasks per cell (bit d-1 = digit d), placed digits per
+    // line and, per cage, the bitset of its tuples that are still possible.
+    // Every change goes through set(), which logs the old value, so a
+    // branch is taken back by undo() to an earlier mark() instead of
+    // copying the whole state.
+    struct State {
+        Mask mask[N][N];
+        Mask rowUsed[N], colUsed[N];
+        vector<uint64_t> live;
+        vector<pair<Mask *, Mask>> trail;
+        vector<pair<uint64_t *, uint64_t>> liveTrail;
+        struct Mark { size_t masks, words; };
+
+        State() { trail.reserve(4 * N * N); }
+        // a copy starts with empty trails; the source's entries point into the source
+        State(const State &o) : live(o.live) {
+            memcpy(mask, o.mask, sizeof mask);
+            memcpy(rowUsed, o.rowUsed, sizeof rowUsed);
+            memcpy(colUsed, o.colUsed, sizeof colUsed);
+            trail.reserve(4 * N * N);
+        }
+        State &operator=(const State &) = delete;
+
+        void set(Mask &w, Mask v) { trail.push_back({&w, w}); w = v; }
+        void set(uint64_t &w, uint64_t v) { liveTrail.push_back({&w, w}); w = v; }
+        Mark mark() const { return {trail.size(), liveTrail.size()}; }
+        void undo(Mark h) {
+            while (trail.size() > h.masks) { *trail.back().first = trail.back().second; trail.pop_back(); }
+            while (liveTrail.size() > h.words) { *liveTrail.back().first = liveTrail.back().second; liveTrail.pop_back(); }
+        }
+    };
+
+    static int pc(unsigned x) { return __builtin_popcount(x); }
+    static int lowv(unsigned m) { return __builtin_ctz(m) + 1; }
+
+    atomic<long long> nodes{0};
+    atomic<long long> found{0};     // solutions seen by count()
+    long long limit = 0;            // count() stops here; 0 = no limit
+    vector<vector<int>> *keep = nullptr;    // if set, the first solutions, row-major
+    mutex keepMu;
+
+    // Fixpoint over the constraints: row r is r, column c is N+c, cage i is
+    // 2N+i. One is queued only when a mask of one of its cells changed, and
+    // a changed cell wakes just its row, its column and (through cageOf)
+    // its cage. seed is the cell fixed by the last branch, or -1 to start
+    // with everything queued.
+    bool propagate(State &st, int seed) {
+        const int C = cages.size(), K = 2 * N + C, CAP = 2 * N + N * N;
+        int q[CAP], head = 0, len = 0;
+        bool queued[CAP] = {};
+        auto push = [&](int k) {
+            if (queued[k]) return;
+            queued[k] = true;
+            q[(head + len++) % CAP] = k;
+        };
+        auto touch = [&](int r, int c) {
+            push(r);
+            push(N + c);
+            push(2 * N + cageOf[r * N + c]);
+        };
+        if (seed < 0) for (int k = 0; k < K; ++k) push(k);
+        else touch(seed / N, seed % N);
+
+        // latin rule on one line: placed digits leave the other cells, and a
+        // digit with a single home is placed there
+        auto line = [&](int idx, bool isRow) -> bool {
+            Mask *cell = isRow ? &st.mask[idx][0] : &st.mask[0][idx];
+            const int stride = isRow ? 1 : N;
+            auto wake = [&](int i) { if (isRow) touch(idx, i); else touch(i, idx); };
+            Mask placed = 0;
+#pragma GCC unroll 16
+            for (int i = 0; i < N; ++i) {
+                Mask m = cell[i * stride];
+                if (pc(m) == 1) {
+                    if (placed & m) return false;
+                    placed |= m;
                 }
             }
-            if (!ok) break;
-        }
+            Mask &used = isRow ? st.rowUsed[idx] : st.colUsed[idx];
+            if (used != placed) st.set(used, placed);
+#pragma GCC unroll 16
+            for (int i = 0; i < N; ++i) {
+                Mask &m = cell[i * stride];
+                if (pc(m) == 1) continue;
+                Mask nm = m & ~placed;
+                if (nm == 0) return false;
+                if (nm != m) { st.set(m, nm); wake(i); }
+            }
+            for (int d = 0; d < N; ++d) {
+                Mask bit = 1u << d;
+                if (placed & bit) continue;
+                int cnt = 0, pos = -1;
+#pragma GCC unroll 16
+                for (int i = 0; i < N; ++i)
+                    if (cell[i * stride] & bit) { cnt++; pos = i; }
+                if (cnt == 0) return false;
+                if (cnt == 1 && cell[pos * stride] != bit) { st.set(cell[pos * stride], bit); wake(pos); }
+            }
+            return true;
+        };
 
-        if (ok && solve(idx+1))
+        // drops the live tuples that use a value a cell has lost, then keeps
+        // only the values some live tuple still supports
+        auto cage = [&](int ci) -> bool {
+            const Cage &cg = cages[ci];
+            const int k = cg.cells.size(), words = cg.words;
+            uint64_t *live = &st.live[cg.liveOff];
+            auto support = [&](int i, int d) { return &cg.support[((size_t)i * MAX_N + d) * words]; };
+            Mask dom[N * N];
+            for (int i = 0; i < k; ++i) dom[i] = st.mask[cg.cells[i].first][cg.cells[i].second];
+            bool any = false;
+            for (int w = 0; w < words; ++w) {
+                uint64_t keepBits = live[w];
+                for (int i = 0; i < k && keepBits; ++i) {
+                    uint64_t u = 0;
+                    for (Mask b = dom[i]; b; b &= b - 1) u |= support(i, __builtin_ctz(b))[w];
+                    keepBits &= u;
+                }
+                if (keepBits != live[w]) st.set(live[w], keepBits);
+                any |= keepBits != 0;
+            }
+            if (!any) return false;
+            for (int i = 0; i < k; ++i) {
+                Mask m = 0;
+                for (Mask b = dom[i]; b; b &= b - 1) {
+                    const uint64_t *sp = support(i, __builtin_ctz(b));
+                    for (int w = 0; w < words; ++w)
+                        if (live[w] & sp[w]) { m |= b & -b; break; }
+                }
+                if (m == dom[i]) continue;
+                int r = cg.cells[i].first, c = cg.cells[i].second;
+                st.set(st.mask[r][c], m);
+                // the live tuples already agree with m, so only the lines wake up
+                push(r);
+                push(N + c);
+            }
             return true;
+        };
 
-        // undo
-        grid[r][c] = 0;
-        rowUsed[r][d] = colUsed[c][d] = false;
+        while (len) {
+            int k = q[head];
+            head = (head + 1) % CAP;
+            --len;
+            queued[k] = false;
+            bool ok = k < N ? line(k, true) : k < 2 * N ? line(k - N, false) : cage(k - 2 * N);
+            if (!ok) return false;
+        }
+        return true;
+    }
+
+    bool solved(const State &st) {
+        for (int r = 0; r < N; ++r)
+            for (int c = 0; c < N; ++c)
+                if (pc(st.mask[r][c]) != 1) return false;
+        return true;
+    }
+
+    // Unfixed cell with the fewest candidates (MRV) as r*N+c
+    int pickCell(const State &st) {
+        int cell = -1, best = N + 1;
+        for (int r = 0; r < N; ++r)
+            for (int c = 0; c < N; ++c) {
+                int p = pc(st.mask[r][c]);
+                if (p > 1 && p < best) { best = p; cell = r * N + c; }
+            }
+        return cell;
+    }
+
+    static void assign(State &st, int r, int c, int d) {
+        Mask bit = 1u << (d - 1);
+        st.set(st.mask[r][c], bit);
+        st.set(st.rowUsed[r], st.rowUsed[r] | bit);
+        st.set(st.colUsed[c], st.colUsed[c] | bit);
+    }
+
+    // st is already propagated; each branch fixes the MRV cell, wakes only
+    // that cell's constraints and is rolled back through the trail
+    bool dfs(State &st) {
+        ++nodes;
+        if (solved(st)) return true;
+        int cell = pickCell(st), br = cell / N, bc = cell % N;
+        Mask m = st.mask[br][bc];
+        for (int d = 1; d <= N; ++d) {
+            if (!(m & (1u << (d - 1)))) continue;
+            auto h = st.mark();
+            assign(st, br, bc, d);
+            if (propagate(st, cell) && dfs(st)) return true;
+            st.undo(h);
+        }
+        return false;
+    }
+
+    bool limitReached() const {
+        return limit && found.load(memory_order_relaxed) >= limit;
+    }
+
+    void record(const State &st) {
+        long long k = found++;
+        if (!keep || k >= limit) return;
+        vector<int> g(N * N);
+        for (int r = 0; r < N; ++r)
+            for (int c = 0; c < N; ++c) g[r * N + c] = lowv(st.mask[r][c]);
+        lock_guard<mutex> lk(keepMu);
+        keep->push_back(g);
+    }
+
+    // Adds the solutions below the propagated st to found, or stops once
+    // the limit is hit
+    void countFrom(State &st, long long &visited) {
+        if (limitReached()) return;
+        ++visited;
+        if (solved(st)) { record(st); return; }
+        int cell = pickCell(st), br = cell / N, bc = cell % N;
+        Mask m = st.mask[br][bc];
+        for (int d = 1; d <= N; ++d) {
+            if (!(m & (1u << (d - 1)))) continue;
+            auto h = st.mark();
+            assign(st, br, bc, d);
+            if (propagate(st, cell)) countFrom(st, visited);
+            st.undo(h);
+        }
+    }
+
+    // Expands the propagated st `depth` levels deep into independent subtrees
+    void split(State &st, int depth, vector<State> &out) {
+        ++nodes;
+        if (solved(st)) { record(st); return; }
+        if (depth == 0) { out.push_back(st); return; }
+        int cell = pickCell(st), br = cell / N, bc = cell % N;
+        Mask m = st.mask[br][bc];
+        for (int d = 1; d <= N; ++d) {
+            if (!(m & (1u << (d - 1)))) continue;
+            auto h = st.mark();
+            assign(st, br, bc, d);
+            if (propagate(st, cell)) split(st, depth - 1, out);
+            st.undo(h);
+        }
+    }
+
+    // Number of solutions, capped at lim (0 = all); lim = 2 decides
+    // uniqueness. The tree is cut at splitDepth and the subtrees are
+    // shared out over a work-stealing pool. keep, if given, gets the
+    // solutions themselves.
+    long long count(long long lim, int splitDepth, int threads,
+                    vector<vector<int>> *keepOut = nullptr) {
+        limit = lim;
+        keep = keepOut;
+        State root = initial();
+        vector<State> tasks;
+        if (propagate(root, -1)) split(root, splitDepth, tasks);
+        int parentN = n;
+        const vector<Cage> &parentCages = cages;
+        const vector<int> &parentCageOf = cageOf;
+        runStealing(tasks, threads, [&](State &st) {
+            if (cages.empty()) { n = parentN; cages = parentCages; cageOf = parentCageOf; }
+            long long visited = 0;
+            countFrom(st, visited);
+            nodes += visited;
+        });
+        return limit ? min(found.load(), limit) : found.load();
+    }
+
+    static State initial() {
+        State st;
+        for (int i = 0; i < N; ++i) {
+            st.rowUsed[i] = st.colUsed[i] = 0;
+            for (int j = 0; j < N; ++j) st.mask[i][j] = FULL;
+        }
+        for (auto &cg : cages)
+            for (int w = 0; w < cg.words; ++w) {
+                int bits = min<size_t>(64, cg.combos.size() - 64 * w);
+                st.live.push_back(bits == 64 ? ~0ull : (1ull << bits) - 1);
+            }
+        return st;
+    }
+
+    bool solve(vector<vector<int>> &grid) {
+        State st = initial();
+        if (!propagate(st, -1) || !dfs(st)) return false;
+        grid.assign(N, vector<int>(N));
+        for (int i = 0; i < N; ++i)
+            for (int j = 0; j < N; ++j)
+                grid[i][j] = lowv(st.mask[i][j]);
+        return true;
+    }
+};
+
+// Calls f with the Engine<N> instantiation for the runtime grid size
+template <int N, class F>
+bool withEngine(F f) {
+    if constexpr (N > MAX_N) {
+        return false;
+    } else {
+        if (n != N) return withEngine<N + 1>(f);
+        Engine<N> e;
+        f(e);
+        return true;
     }
-    return false;
 }
 
-int main(){
-    memset(grid,    0, sizeof(grid));
-    memset(rowUsed, 0, sizeof(rowUsed));
-    memset(colUsed, 0, sizeof(colUsed));
+// Puzzle file: the grid size, then one cage per line as the target with
+// its operator (+ - x /) followed by 0-based "row,col" cells, e.g.
+//   6
+//   10+ 0,0 0,1 0,2
+// Every cell must be in exactly one cage. A blank line after the cages
+// ends the puzzle, so one file can hold several.
+bool readPuzzle(istream &in) {
+    if (!(in >> n) || n < MIN_N || n > MAX_N) return false;
+    cages.clear();
+    vector<vector<int>> owner(n, vector<int>(n, 0));
+    string line;
+    getline(in, line);
+    while (getline(in, line)) {
+        istringstream ls(line);
+        string head;
+        if (!(ls >> head)) {
+            if (cages.empty()) continue;
+            break;
+        }
+        if (head[0] == '#') continue;
+        Cage cg;
+        char op = head.back();
+        cg.target = atoi(head.c_str());
+        switch (op) {
+          case '+': cg.op = ADD; break;
+          case '-': cg.op = SUB; break;
+          case 'x': case '*': cg.op = MUL; break;
+          case '/': cg.op = DIV; break;
+          default: return false;
+        }
+        string cell;
+        while (ls >> cell) {
+            int r, c;
+            if (sscanf(cell.c_str(), "%d,%d", &r, &c) != 2 ||
+                r < 0 || r >= n || c < 0 || c >= n) return false;
+            owner[r][c]++;
+            cg.cells.push_back({r, c});
+        }
+        if (cg.cells.empty()) return false;
+        cages.push_back(cg);
+    }
+    for (auto &row : owner)
+        for (int k : row)
+            if (k != 1) return false;
+    return true;
+}
+
+// ---- generator ----
+
+// Loads a generator candidate into cages and counts its solutions, up to two
+long long candidateSolutions(int size, const vector<GenCage> &gen, vector<vector<int>> &sols) {
+    n = size;
+    cages.clear();
+    for (auto &g : gen)
+        if (!g.cells.empty()) cages.push_back({g.target, g.op, g.cells});
+    indexCages();
+    long long found = 0;
+    withEngine<MIN_N>([&](auto &e) { found = e.count(2, 0, 1, &sols); });
+    return found;
+}
+
+// The loaded puzzle in the puzzle file format
+void writePuzzle(ostream &os) {
+    const char opChar[] = {'+', '-', 'x', '/'};
+    os << n << "\n";
+    for (auto &cg : cages) {
+        os << cg.target << opChar[cg.op];
+        for (auto &p : cg.cells) os << ' ' << p.first << ',' << p.second;
+        os << "\n";
+    }
+}
 
+// Solves or counts the loaded puzzle
+void run(long long limit, int depth, int threads) {
+    indexCages();
+    if (limit >= 0) {
+        long long found = 0, nodes = 0;
+        withEngine<MIN_N>([&](auto &e) {
+            found = e.count(limit, depth, threads);
+            nodes = e.nodes;
+        });
+        cout << "Solutions: " << found << (limit && found >= limit ? "+" : "")
+             << " (" << nodes << " nodes)\n";
+        if (limit != 1)
+            cout << (found == 0 ? "no solution\n" : found == 1 ? "unique\n" : "not unique\n");
+        return;
+    }
+    vector<vector<int>> grid;
+    long long nodes = 0;
+    bool ok = false;
+    withEngine<MIN_N>([&](auto &e) {
+        ok = e.solve(grid);
+        nodes = e.nodes;
+    });
+    if (ok) {
+        cout << "Solution (" << nodes << " nodes):\n";
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j)
+                cout << grid[i][j] << ' ';
+            cout << "\n";
+        }
+    } else {
+        cout << "No solution found.\n";
+    }
+}
+
+// Usage: Haz25Kendoku [-c limit] [-t threads] [-d depth] [puzzle]
+//        Haz25Kendoku --generate count [-n size] [-m maxcage] [-s seed] [-t threads] [-o file]
+//   -c  count solutions up to limit (0 = all, 2 = uniqueness check)
+//   -t  worker threads for -c and --generate (default: all cores)
+//   -d  search depth at which -c splits the tree into subproblems
+//   --generate  write count random puzzles that have exactly one solution
+int main(int argc, char **argv){
+    long long limit = -1;
+    int threads = max(1u, thread::hardware_concurrency()), depth = 3;
+    const char *path = nullptr, *outPath = nullptr;
+    GenOptions gen;
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "-c") && hasValue) limit = max(0LL, atoll(argv[++i]));
+        else if (!strcmp(argv[i], "-t") && hasValue) threads = max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "-d") && hasValue) depth = max(0, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--generate") && hasValue) gen.count = max(0LL, atoll(argv[++i]));
+        else if (!strcmp(argv[i], "-n") && hasValue) gen.size = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-m") && hasValue) gen.maxCage = max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "-s") && hasValue) gen.seed = strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "-o") && hasValue) outPath = argv[++i];
+        else path = argv[i];
+    }
+    if (gen.count > 0) {
+        if (gen.size < MIN_N || gen.size > MAX_N) {
+            cout << "Size must be " << MIN_N << ".." << MAX_N << "\n";
+            return 1;
+        }
+        gen.threads = threads;
+        if (!outPath) return generate(gen, cout, candidateSolutions, writePuzzle);
+        ofstream f(outPath);
+        if (!f) {
+            cout << "Cannot write " << outPath << "\n";
+            return 1;
+        }
+        return generate(gen, f, candidateSolutions, writePuzzle);
+    }
+    if (path) {
+        ifstream f(path);
+        int done = 0;
+        while (f && readPuzzle(f)) {
+            if (done++) cout << "\n";
+            run(limit, depth, threads);
+        }
+        if (!done || !f.eof()) {
+            cout << "Cannot read puzzle " << path << "\n";
+            return 1;
+        }
+        return 0;
+    }
     // --- cages initializer (all coordinates 0‐based) ---
+    n = 6;
     cages = {
         {10, ADD, {{0,0},{0,1},{0,2}}},           // 10+ in (1,1),(1,2),(1,3)
         { 2, DIV, {{0,3},{1,3}}},                 // 2/  in (1,4),(2,4)
@@ -111,16 +576,6 @@ int main(){
         { 2, MUL, {{5,0},{5,1}}},                 // 2×  in (6,1),(6,2)
         {12, MUL, {{5,4},{5,5}}}                  // 12× in (6,5),(6,6)
     };
-
-    if (solve()) {
-        cout << "Solution:\n";
-        for (int i = 0; i < N; ++i) {
-            for (int j = 0; j < N; ++j)
-                cout << grid[i][j] << ' ';
-            cout << "\n";
-        }
-    } else {
-        cout << "No solution found.\n";
-    }
+    run(limit, depth, threads);
     return 0;
-}
\ No newline at end of file
+}
@@ -2,6 +2,7 @@
 using namespace std;
 
 constexpr int N = 6;
+static_assert(N >= 1 && N <= 8, "a row packs into one 64-bit word, 8 bits per column");
 
 // Clues for each side; 0 means “no clue”
 int topClue   [N] = {3, 0, 0, 3, 3, 0};
@@ -9,13 +10,31 @@ int bottomClue[N] = {0, 3, 3, 3, 0, 3};
 int leftClue  [N] = {0, 0, 4, 0, 0, 0};
 int rightClue [N] = {3, 0, 2, 0, 4, 0};
 
+// One permutation of 1..N with its digits packed: byte c holds
+// 1 << (a[c]-1), so testing it against per-position allowed digits is one AND
+struct Perm {
+    uint8_t a[N];
+    uint64_t bits;
+};
+
+vector<Perm> perms;
+// perms matching (left, right) visible counts, or (top, bottom) for a
+// column; 0 = no clue on that side
+vector<int> byClue[N+1][N+1];
+
 int grid[N][N];
-bool usedRow[N][N+1], usedCol[N][N+1], usedD1[N+1], usedD2[N+1];
+unsigned usedD1, usedD2;    // digits already on each diagonal
+unsigned rowDone;           // rows with a permutation assigned
+
+// cand[L][i]: perms still possible at depth L for row i (i < N) or for
+// column i-N read top to bottom; rows and columns share the perm tables
+vector<int> cand[N+1][2*N];
 
-// count how many “buildings” are visible from the front of a 1..N array
-int visibleCount(const vector<int>& a) {
+// count how many “buildings” are visible walking a[0], a[step], ...
+int visibleCount(const int* a, int step) {
     int mx = 0, vis = 0;
-    for (int x : a) {
+    for (int i = 0; i < N; ++i) {
+        int x = a[i*step];
         if (x > mx) {
             mx = x;
             ++vis;
@@ -24,15 +43,63 @@ int visibleCount(const vector<int>& a) {
     return vis;
 }
 
-// extract a column into a vector
-vector<int> getCol(int c) {
-    vector<int> v(N);
-    for (int r = 0; r < N; ++r) v[r] = grid[r][c];
-    return v;
+// every permutation of 1..N, bucketed by its left/right clue pair
+void buildTables() {
+    int a[N];
+    iota(a, a + N, 1);
+    do {
+        Perm p;
+        p.bits = 0;
+        for (int c = 0; c < N; ++c) {
+            p.a[c] = a[c];
+            p.bits |= uint64_t(1) << (8*c + a[c] - 1);
+        }
+        int l = visibleCount(a, 1), r = visibleCount(a + N - 1, -1);
+        int id = perms.size();
+        perms.push_back(p);
+        for (int lk : {0, l})
+            for (int rk : {0, r})
+                byClue[lk][rk].push_back(id);
+    } while (next_permutation(a, a + N));
 }
 
-bool dfs(int r, int c) {
-    if (r == N) {
+// Rows and columns filter each other: a row perm survives only if each of
+// its digits is still possible in that column, and the same for columns.
+// "Possible" is the OR of the other side's packed bits, so each test is
+// one AND. Repeats until nothing changes.
+bool propagate(int L) {
+    for (bool changed = true; changed; ) {
+        changed = false;
+        for (int side = 0; side < 2; ++side) {
+            // byte k of other[j]: digits line j of the other side can hold at position k
+            uint64_t other[N];
+            for (int j = 0; j < N; ++j) {
+                other[j] = 0;
+                for (int id : cand[L][(1-side)*N + j]) other[j] |= perms[id].bits;
+            }
+            for (int i = 0; i < N; ++i) {
+                uint64_t allow = 0;
+                for (int j = 0; j < N; ++j) allow |= (other[j] >> 8*i & 0xFF) << 8*j;
+                bool diag = side == 0 && !(rowDone >> i & 1);
+                vector<int>& v = cand[L][side*N + i];
+                size_t before = v.size();
+                v.erase(remove_if(v.begin(), v.end(), [&](int id) {
+                    const Perm& p = perms[id];
+                    if (p.bits & ~allow) return true;
+                    return diag && ((usedD1 >> p.a[i] & 1) || (usedD2 >> p.a[N-1-i] & 1));
+                }), v.end());
+                if (v.empty()) return false;
+                if (v.size() != before) changed = true;
+            }
+        }
+    }
+    return true;
+}
+
+// assign whole rows, most constrained row first; left/right and top/bottom
+// clues are already baked into the tables
+bool dfs(int L) {
+    if (L == N) {
         // solved: print
         for (int i = 0; i < N; ++i) {
             for (int j = 0; j < N; ++j) {
@@ -41,52 +108,30 @@ bool dfs(int r, int c) {
         }
         return true;
     }
-    int nr = r, nc = c+1;
-    if (nc == N) {
-        nr = r+1;
-        nc = 0;
-    }
 
-    bool onD1 = (r == c);
-    bool onD2 = (r + c == N-1);
+    int r = -1;
+    for (int i = 0; i < N; ++i)
+        if (!(rowDone >> i & 1) && (r < 0 || cand[L][i].size() < cand[L][r].size())) r = i;
 
-    for (int v = 1; v <= N; ++v) {
-        if (usedRow[r][v] || usedCol[c][v]) continue;
-        if (onD1 && usedD1[v]) continue;
-        if (onD2 && usedD2[v]) continue;
+    for (int id : cand[L][r]) {
+        const Perm& p = perms[id];
+        unsigned d1 = 1u << p.a[r], d2 = 1u << p.a[N-1-r];
+        if ((usedD1 & d1) || (usedD2 & d2)) continue;
 
         // place
-        grid[r][c] = v;
-        usedRow[r][v] = usedCol[c][v] = true;
-        if (onD1) usedD1[v] = true;
-        if (onD2) usedD2[v] = true;
-
-        bool ok = true;
-
-        // if end of row, check left/right clues
-        if (c == N-1) {
-            vector<int> rowv(grid[r], grid[r] + N);
-            int visL = visibleCount(rowv);
-            int visR = visibleCount(vector<int>(rowv.rbegin(), rowv.rend()));
-            if (leftClue[r]  && visL != leftClue[r])  ok = false;
-            if (rightClue[r] && visR != rightClue[r]) ok = false;
-        }
+        for (int i = 0; i < 2*N; ++i) cand[L+1][i] = cand[L][i];
+        cand[L+1][r].assign(1, id);
+        for (int c = 0; c < N; ++c) grid[r][c] = p.a[c];
+        usedD1 |= d1;
+        usedD2 |= d2;
+        rowDone |= 1u << r;
 
-        // if end of column, check top/bottom clues
-        if (ok && r == N-1) {
-            auto colv = getCol(c);
-            int visT = visibleCount(colv);
-            int visB = visibleCount(vector<int>(colv.rbegin(), colv.rend()));
-            if (topClue[c]    && visT != topClue[c])    ok = false;
-            if (bottomClue[c] && visB != bottomClue[c]) ok = false;
-        }
-
-        if (ok && dfs(nr, nc)) return true;
+        if (propagate(L+1) && dfs(L+1)) return true;
 
         // undo
-        usedRow[r][v] = usedCol[c][v] = false;
-        if (onD1) usedD1[v] = false;
-        if (onD2) usedD2[v] = false;
+        usedD1 &= ~d1;
+        usedD2 &= ~d2;
+        rowDone &= ~(1u << r);
     }
 
     return false;
@@ -94,13 +139,15 @@ bool dfs(int r, int c) {
 
 int main() {
     // initialize
-    memset(usedRow,  false, sizeof usedRow);
-    memset(usedCol,  false, sizeof usedCol);
-    memset(usedD1,   false, sizeof usedD1);
-    memset(usedD2,   false, sizeof usedD2);
+    buildTables();
+    usedD1 = usedD2 = rowDone = 0;
+    for (int i = 0; i < N; ++i) {
+        cand[0][i]     = byClue[leftClue[i]][rightClue[i]];
+        cand[0][N + i] = byClue[topClue[i]][bottomClue[i]];
+    }
 
-    if (!dfs(0,0)) {
+    if (!propagate(0) || !dfs(0)) {
         cout << "No solution found\n";
     }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,245 @@
+// Pieces shared by Haz25Kendoku.cpp and Eki25IslemsizKendoku.cpp
+#pragma once
+#include <bits/stdc++.h>
+
+// Runs work(task) for every task on `threads` workers. Tasks are dealt
+// round-robin into per-worker deques; a worker takes from the back of its
+// own deque and steals from the front of another's once it runs dry.
+template <class T, class F>
+void runStealing(std::vector<T> &tasks, int threads, F work) {
+    threads = std::max(1, std::min<int>(threads, tasks.size()));
+    if (threads == 1) {
+        for (auto &t : tasks) work(t);
+        return;
+    }
+    std::vector<std::deque<T *>> dq(threads);
+    std::vector<std::mutex> mu(threads);
+    for (size_t i = 0; i < tasks.size(); ++i) dq[i % threads].push_back(&tasks[i]);
+    auto take = [&](int w) -> T * {
+        for (int k = 0; k < threads; ++k) {
+            int v = (w + k) % threads;
+            std::lock_guard<std::mutex> lk(mu[v]);
+            if (dq[v].empty()) continue;
+            T *t;
+            if (k == 0) { t = dq[v].back(); dq[v].pop_back(); }
+            else        { t = dq[v].front(); dq[v].pop_front(); }
+            return t;
+        }
+        return nullptr;
+    };
+    std::vector<std::thread> pool;
+    for (int w = 0; w < threads; ++w)
+        pool.emplace_back([&, w] { while (T *t = take(w)) work(*t); });
+    for (auto &t : pool) t.join();
+}
+
+// ---- generator ----
+
+enum Op { ADD, SUB, MUL, DIV };
+
+// A cage of a candidate puzzle: its cells and the clue their values give.
+// The operator-less solver reads only the target.
+struct GenCage {
+    std::vector<std::pair<int,int>> cells;
+    int target = 0;
+    Op op = ADD;
+};
+
+struct GenOptions {
+    int size = 6, maxCage = 4, threads = 1;
+    long long count = 0;
+    unsigned seed = 1;
+};
+
+// Random latin square built row by row: each row is a perfect matching of
+// columns to digits not yet in that column, grown by augmenting paths tried
+// in random order. A latin rectangle always extends, so no row fails.
+inline std::vector<std::vector<int>> randomLatin(int size, std::mt19937 &rng) {
+    std::vector<std::vector<int>> g(size, std::vector<int>(size, 0));
+    std::vector<unsigned> colUsed(size, 0);
+    for (int r = 0; r < size; ++r) {
+        std::vector<int> owner(size + 1, -1);   // digit -> column
+        std::vector<char> seen;
+        std::function<bool(int)> augment = [&](int c) {
+            int digits[32];                     // colUsed holds digits as bits
+            std::iota(digits, digits + size, 1);
+            std::shuffle(digits, digits + size, rng);
+            for (int k = 0; k < size; ++k) {
+                int d = digits[k];
+                if ((colUsed[c] >> d & 1) || seen[d]) continue;
+                seen[d] = 1;
+                if (owner[d] < 0 || augment(owner[d])) { owner[d] = c; return true; }
+            }
+            return false;
+        };
+        std::vector<int> order(size);
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), rng);
+        for (int c : order) {
+            seen.assign(size + 1, 0);
+            augment(c);
+        }
+        for (int d = 1; d <= size; ++d) {
+            g[r][owner[d]] = d;
+            colUsed[owner[d]] |= 1u << d;
+        }
+    }
+    return g;
+}
+
+// Gives cage cg an operator and the target its values v reach with it:
+// any of + - x / for two cells, + or x for more, + for a single cell
+inline void randomClue(GenCage &cg, const std::vector<int> &v, std::mt19937 &rng) {
+    long long sum = 0, prod = 1;
+    for (int x : v) { sum += x; prod *= x; }
+    cg.op = ADD;
+    cg.target = sum;
+    if (v.size() == 2) {
+        int a = std::max(v[0], v[1]), b = std::min(v[0], v[1]);
+        switch (rng() % 4) {
+          case 1: if (a > b) { cg.op = SUB; cg.target = a - b; } break;
+          case 2: cg.op = MUL; cg.target = prod; break;
+          case 3: if (a % b == 0 && a > b) { cg.op = DIV; cg.target = a / b; } break;
+        }
+    } else if (v.size() > 2 && rng() % 2 && prod <= 1000000000) {
+        cg.op = MUL;
+        cg.target = prod;
+    }
+}
+
+// Builds one candidate: a random square cut into random cages with random
+// clues. solutions(size, cages, sols) loads the candidate into the solver
+// and returns its solution count capped at 2, the solutions going to sols.
+// While a second solution exists (up to 4n rounds), a cell where the two
+// differ is picked and its cage is merged with a neighbouring cage, or the
+// cell is split off if the rest stays connected. Returns true with the
+// unique candidate still loaded.
+template <class Solutions>
+bool generateOne(const GenOptions &opt, std::mt19937 &rng, Solutions solutions) {
+    typedef std::pair<int,int> Cell;
+    const int n = opt.size;
+    auto L = randomLatin(n, rng);
+    std::vector<int> flatL;
+    for (auto &row : L) flatL.insert(flatL.end(), row.begin(), row.end());
+    std::vector<int> owner(n * n, -1);
+    std::vector<GenCage> groups;
+    std::vector<int> sizes = {1, 2, 2, 2, 3, 3, 3, 4};
+    for (int s = 5; s <= opt.maxCage; ++s) sizes.push_back(s);
+    std::vector<int> order(n * n);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), rng);
+    const int dr[4] = {0, 1, 0, -1}, dc[4] = {1, 0, -1, 0};
+    for (int x : order) {
+        if (owner[x] >= 0) continue;
+        int want = std::min(opt.maxCage, sizes[rng() % sizes.size()]);
+        int id = groups.size();
+        groups.push_back({{{x / n, x % n}}});
+        owner[x] = id;
+        while ((int)groups[id].cells.size() < want) {
+            std::vector<int> frontier;
+            for (auto &p : groups[id].cells)
+                for (int k = 0; k < 4; ++k) {
+                    int r = p.first + dr[k], c = p.second + dc[k];
+                    if (r >= 0 && r < n && c >= 0 && c < n && owner[r * n + c] < 0)
+                        frontier.push_back(r * n + c);
+                }
+            if (frontier.empty()) break;
+            int y = frontier[rng() % frontier.size()];
+            owner[y] = id;
+            groups[id].cells.push_back({y / n, y % n});
+        }
+    }
+    auto reclue = [&](int g) {
+        std::vector<int> v;
+        for (auto &p : groups[g].cells) v.push_back(L[p.first][p.second]);
+        randomClue(groups[g], v, rng);
+    };
+    for (int g = 0; g < (int)groups.size(); ++g) reclue(g);
+    auto connected = [&](const std::vector<Cell> &cells) {
+        std::set<Cell> left(cells.begin(), cells.end()), seen{cells[0]};
+        std::vector<Cell> todo{cells[0]};
+        while (!todo.empty()) {
+            Cell p = todo.back();
+            todo.pop_back();
+            for (int k = 0; k < 4; ++k) {
+                Cell q{p.first + dr[k], p.second + dc[k]};
+                if (left.count(q) && seen.insert(q).second) todo.push_back(q);
+            }
+        }
+        return seen.size() == cells.size();
+    };
+
+    for (int round = 0; round < 4 * n; ++round) {
+        std::vector<std::vector<int>> sols;
+        long long found = solutions(n, groups, sols);
+        if (found == 1) return true;
+        if (found == 0) return false;
+        const std::vector<int> &other = sols[0] == flatL ? sols[1] : sols[0];
+        std::vector<int> diff;
+        for (int x = 0; x < n * n; ++x)
+            if (other[x] != flatL[x]) diff.push_back(x);
+        int x = diff[rng() % diff.size()], g = owner[x];
+        std::vector<int> neighbours;
+        for (auto &p : groups[g].cells)
+            for (int k = 0; k < 4; ++k) {
+                int r = p.first + dr[k], c = p.second + dc[k];
+                if (r < 0 || r >= n || c < 0 || c >= n) continue;
+                int h = owner[r * n + c];
+                if (h != g && (int)(groups[g].cells.size() + groups[h].cells.size()) <= opt.maxCage)
+                    neighbours.push_back(h);
+            }
+        std::vector<Cell> rest;
+        for (auto &p : groups[g].cells)
+            if (p != Cell(x / n, x % n)) rest.push_back(p);
+        bool canSplit = !rest.empty() && connected(rest);
+        if (!neighbours.empty() && (!canSplit || rng() % 2)) {
+            int h = neighbours[rng() % neighbours.size()];
+            for (auto &p : groups[h].cells) {
+                owner[p.first * n + p.second] = g;
+                groups[g].cells.push_back(p);
+            }
+            groups[h].cells.clear();
+            reclue(g);
+        } else if (canSplit) {
+            groups[g].cells = rest;
+            reclue(g);
+            owner[x] = groups.size();
+            groups.push_back({{{x / n, x % n}}});
+            reclue(groups.size() - 1);
+        } else {
+            reclue(g);
+        }
+    }
+    return false;
+}
+
+// Writes opt.count puzzles with exactly one solution to out, with one
+// generator per thread, each on its own random stream. write(os) prints the
+// puzzle generateOne left loaded on the calling thread.
+template <class Solutions, class Write>
+int generate(const GenOptions &opt, std::ostream &out, Solutions solutions, Write write) {
+    std::atomic<long long> made{0}, tried{0};
+    std::mutex outMu;
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int w = 0; w < opt.threads; ++w)
+        pool.emplace_back([&, w] {
+            std::mt19937 rng(opt.seed * 7919u + w);
+            while (made.load() < opt.count) {
+                tried++;
+                if (!generateOne(opt, rng, solutions)) continue;
+                std::ostringstream os;
+                write(os);
+                os << "\n";
+                std::lock_guard<std::mutex> lk(outMu);
+                if (made.load() >= opt.count) break;
+                made++;
+                out << os.str() << std::flush;
+            }
+        });
+    for (auto &t : pool) t.join();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cerr << made.load() << " unique puzzles from " << tried.load() << " candidates in "
+              << sec << " s (" << made.load() / std::max(sec, 1e-9) << "/s)\n";
+    return 0;
+}
@@ -1,120 +1,3610 @@
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
 #include <vector>
+#include <array>
+#include <list>
+#include <set>
+#include <unordered_map>
+#include <memory>
 #include <thread>
 #include <chrono>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <csignal>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <cerrno>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include <gmpxx.h>
 
 extern "C" {
 #include <ecm.h>  // The GMP-ECM C header
 }
 
-std::atomic_bool g_foundFactor(false);
-mpz_class g_factor(0);
-std::mutex g_factorMutex;
+std::mutex g_logMutex;
+bool g_verbose = true;
 
-static const char* N_str = 
+static const char* N_str =
   "1000000000000000000000000000000000000000000000000000000000000019";
 
-// Each thread tries a certain number of curves
-void workerECM(const mpz_class& N, unsigned threadID, unsigned totalCurvesPerThread)
+// One rung of the ECM ladder: running 'curves' curves at this B1 (with
+// GMP-ECM's default B2, listed for the telemetry model) finds a factor of
+// 'digits' digits with probability about 1 - 1/e. Values are the
+// default-polynomial column of the GMP-ECM README table.
+struct EcmLevel
 {
-    mpz_t mpzN;
-    mpz_init_set(mpzN, N.get_mpz_t());
+    unsigned digits;
+    double B1;
+    double B2;
+    unsigned curves;
+};
 
-    mpz_t factor;
+static const EcmLevel kLevels[] = {
+    {20, 11e3, 1.9e6,     74},
+    {25, 5e4,  1.3e7,    214},
+    {30, 25e4, 1.3e8,    430},
+    {35, 1e6,  1.0e9,    904},
+    {40, 3e6,  5.7e9,   2350},
+    {45, 11e6, 3.5e10,  4480},
+    {50, 43e6, 2.4e11,  7553},
+    {55, 11e7, 7.8e11, 17769},
+    {60, 26e7, 3.2e12, 42017},
+    {65, 85e7, 1.6e13, 69408},
+};
+static const unsigned kNumLevels = sizeof(kLevels) / sizeof(kLevels[0]);
+
+// Budgets for the cheap methods that run before any ECM curve. Rho at 2^22
+// iterations reliably finds factors up to ~12 digits; P-1 and P+1 catch
+// larger factors whose p-1 / p+1 happen to be smooth.
+static const unsigned long kTrialLimit = 1ul << 20;
+static const unsigned long kRhoIterations = 1ul << 22;
+static const double kPm1B1 = 1e7;
+static const double kPp1B1 = 5e6;
+
+// Curves completed per level over all jobs since startup, for telemetry.
+std::atomic<unsigned long> g_levelCurves[kNumLevels];
+
+// Each job gets its own block of sigmas so cofactor jobs never rerun a curve
+// their parent already tried; a full ladder is well under 2^20 curves.
+static const unsigned kSigmaBlockBits = 20;
+
+static std::vector<unsigned long> sievePrimes(unsigned long limit)
+{
+    std::vector<bool> composite(limit + 1, false);
+    std::vector<unsigned long> primes;
+    for (unsigned long i = 2; i <= limit; i++)
+    {
+        if (composite[i]) continue;
+        primes.push_back(i);
+        for (unsigned long j = i * i; j <= limit; j += i) composite[j] = true;
+    }
+    return primes;
+}
+
+static const std::vector<unsigned long>& smallPrimes()
+{
+    static const std::vector<unsigned long> primes = sievePrimes(kTrialLimit);
+    return primes;
+}
+
+// Strong Fermat test to base 2.
+static bool isStrongProbablePrime2(const mpz_class& n)
+{
+    mpz_class d = n - 1, x, nm1 = n - 1, two = 2;
+    unsigned long s = mpz_scan1(d.get_mpz_t(), 0);
+    mpz_tdiv_q_2exp(d.get_mpz_t(), d.get_mpz_t(), s);
+    mpz_powm(x.get_mpz_t(), two.get_mpz_t(), d.get_mpz_t(), n.get_mpz_t());
+    if (x == 1 || x == nm1) return true;
+    for (unsigned long r = 1; r < s; r++)
+    {
+        mpz_powm_ui(x.get_mpz_t(), x.get_mpz_t(), 2, n.get_mpz_t());
+        if (x == nm1) return true;
+        if (x == 1) return false;
+    }
+    return false;
+}
+
+// Halves v modulo odd n.
+static void halveMod(mpz_class& v, const mpz_class& n)
+{
+    if (mpz_odd_p(v.get_mpz_t())) v += n;
+    mpz_tdiv_q_2exp(v.get_mpz_t(), v.get_mpz_t(), 1);
+}
+
+// Strong Lucas test with Selfridge's parameters: D is the first of
+// 5, -7, 9, -11, ... with (D/n) = -1, P = 1, Q = (1 - D) / 4.
+static bool isStrongLucasProbablePrime(const mpz_class& n)
+{
+    if (mpz_perfect_square_p(n.get_mpz_t())) return false;
+    long D = 5;
+    for (;;)
+    {
+        mpz_class Dz = D;
+        int j = mpz_jacobi(Dz.get_mpz_t(), n.get_mpz_t());
+        if (j == -1) break;
+        if (j == 0 && mpz_cmpabs_ui(n.get_mpz_t(), std::labs(D)) != 0)
+            return false;
+        D = D > 0 ? -(D + 2) : -D + 2;
+    }
+    const long Q = (1 - D) / 4;
+
+    // n + 1 = d * 2^s with d odd
+    mpz_class d = n + 1;
+    unsigned long s = mpz_scan1(d.get_mpz_t(), 0);
+    mpz_tdiv_q_2exp(d.get_mpz_t(), d.get_mpz_t(), s);
+
+    auto reduce = [&n](mpz_class& v) {
+        mpz_mod(v.get_mpz_t(), v.get_mpz_t(), n.get_mpz_t());
+    };
+
+    // Binary Lucas chain for U_d, V_d, Q^d, starting from U_1, V_1 = P = 1.
+    mpz_class U = 1, V = 1, Qk = Q, t;
+    reduce(Qk);
+    for (long bit = long(mpz_sizeinbase(d.get_mpz_t(), 2)) - 2; bit >= 0; bit--)
+    {
+        U = U * V;                            // U_2k = U_k V_k
+        V = V * V - 2 * Qk;                   // V_2k = V_k^2 - 2 Q^k
+        Qk = Qk * Qk;
+        reduce(U);
+        reduce(V);
+        reduce(Qk);
+        if (mpz_tstbit(d.get_mpz_t(), bit))
+        {
+            t = U + V;                        // U_2k+1 = (P U + V) / 2
+            V = D * U + V;                    // V_2k+1 = (D U + P V) / 2
+            U = t;
+            reduce(U);
+            reduce(V);
+            halveMod(U, n);
+            halveMod(V, n);
+            Qk = Qk * Q;
+            reduce(Qk);
+        }
+    }
+    if (U == 0 || V == 0) return true;
+    for (unsigned long r = 1; r < s; r++)
+    {
+        V = V * V - 2 * Qk;                   // V_2^r d
+        reduce(V);
+        if (V == 0) return true;
+        Qk = Qk * Qk;
+        reduce(Qk);
+    }
+    return false;
+}
+
+// Baillie-PSW: trial division by a few small primes, a base-2 strong test
+// and a strong Lucas test. No composite passing both is known.
+static bool isProbablePrimeBPSW(const mpz_class& n)
+{
+    if (n < 2) return false;
+    static const unsigned long kQuick[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+    for (unsigned long p : kQuick)
+    {
+        if (n == p) return true;
+        if (mpz_divisible_ui_p(n.get_mpz_t(), p)) return false;
+    }
+    return isStrongProbablePrime2(n) && isStrongLucasProbablePrime(n);
+}
+
+// Strips every prime below kTrialLimit from N, recording each occurrence.
+static void trialDivide(mpz_class& N, std::vector<mpz_class>& factors)
+{
+    for (unsigned long p : smallPrimes())
+    {
+        if (N < mpz_class(p) * p) break;
+        while (mpz_divisible_ui_p(N.get_mpz_t(), p))
+        {
+            mpz_divexact_ui(N.get_mpz_t(), N.get_mpz_t(), p);
+            factors.push_back(p);
+        }
+    }
+    if (N > 1 && N <= mpz_class(kTrialLimit) * kTrialLimit)
+    {
+        // every prime below the limit is gone, so what is left is prime
+        factors.push_back(N);
+        N = 1;
+    }
+}
+
+// "3-7,9,12-13" for a sorted list; "-" when empty.
+static std::string formatRanges(const std::vector<unsigned long>& v)
+{
+    std::string s;
+    for (size_t i = 0; i < v.size();)
+    {
+        size_t k = i;
+        while (k + 1 < v.size() && v[k + 1] == v[k] + 1) k++;
+        if (!s.empty()) s += ",";
+        s += std::to_string(v[i]);
+        if (k > i) s += "-" + std::to_string(v[k]);
+        i = k + 1;
+    }
+    return s.empty() ? "-" : s;
+}
+
+static void parseRanges(const std::string& s, std::vector<unsigned long>& out)
+{
+    std::istringstream in(s);
+    std::string part;
+    while (std::getline(in, part, ','))
+    {
+        if (part.empty() || part == "-") continue;
+        size_t dash = part.find('-');
+        unsigned long a = std::stoul(part.substr(0, dash));
+        unsigned long b = dash == std::string::npos ? a : std::stoul(part.substr(dash + 1));
+        for (unsigned long v = a; v <= b; v++) out.push_back(v);
+    }
+}
+
+// GMP-ECM polls this during both stages; a nonzero return abandons the curve,
+// so once its job has been split the other threads stop within milliseconds.
+// Rho and the SIQS sievers poll it too.
+thread_local const std::atomic_bool* t_stop = nullptr;
+
+static int stopAsap()
+{
+    return t_stop && t_stop->load(std::memory_order_relaxed) ? 1 : 0;
+}
+
+// ---------------------------------------------------------------------------
+// Self-initializing quadratic sieve, for composites of 30..100 digits where
+// the smallest factor may be as large as the square root.
+//
+// Polynomials are g(x) = A x^2 + 2 B x + C with A = q_1 ... q_s a product of
+// factor-base primes close to sqrt(2kN)/M, so that (Ax + B)^2 - kN = A g(x)
+// and |g(x)| stays below M sqrt(kN/2) on [-M, M). Each A yields 2^(s-1)
+// polynomials (B = +-B_1 +- ... +- B_s), visited in Gray-code order so each
+// switch moves every sieve root by one precomputed amount. Every thread that
+// joins picks its own A values and sieves independently; relations (and
+// single-large-prime partials, paired on the fly) go into a shared store.
+// The matrix is cut down with structured Gaussian elimination (singleton
+// removal and weight-2 merges) and then solved densely over GF(2).
+// ---------------------------------------------------------------------------
+
+// Parameters by size of kN in decimal digits; rows are interpolated.
+struct SiqsParams
+{
+    unsigned digits;
+    unsigned fbSize;        // primes in the factor base
+    unsigned blocks;        // sieve interval [-M, M) in 32 KiB blocks
+    unsigned lpMult;        // large prime bound = lpMult * largest FB prime
+};
+
+static const SiqsParams kSiqsParams[] = {
+    { 30,   200,  2,  30},
+    { 40,   500,  2,  40},
+    { 50,  1200,  4,  50},
+    { 60,  2400,  6,  60},
+    { 70,  4500,  8,  70},
+    { 80,  9000, 10,  80},
+    { 90, 18000, 12,  90},
+    {100, 36000, 16, 100},
+};
+static const unsigned kSiqsMinDigits = 30;
+static const unsigned kSiqsMaxDigits = 100;
+static const unsigned kSieveBlock = 32768;
+static const unsigned kSieveMinPrime = 40;      // smaller primes are not sieved
+static const unsigned kSiqsExtraRelations = 64;
+
+static uint32_t powMod32(uint64_t b, uint64_t e, uint32_t m)
+{
+    uint64_t r = 1;
+    b %= m;
+    for (; e; e >>= 1)
+    {
+        if (e & 1) r = r * b % m;
+        b = b * b % m;
+    }
+    return uint32_t(r);
+}
+
+static uint32_t invMod32(uint32_t a, uint32_t m)
+{
+    int64_t t = 0, nt = 1, r = m, nr = a % m;
+    while (nr)
+    {
+        int64_t q = r / nr;
+        std::swap(t, nt);
+        nt -= q * t;
+        std::swap(r, nr);
+        nr -= q * r;
+    }
+    return uint32_t(t < 0 ? t + m : t);
+}
+
+// Tonelli-Shanks square root of a quadratic residue a mod an odd prime p.
+static uint32_t sqrtMod32(uint32_t a, uint32_t p)
+{
+    a %= p;
+    if (a == 0) return 0;
+    if (p % 4 == 3) return powMod32(a, (p + 1) / 4, p);
+    uint32_t q = p - 1, s = 0;
+    while (!(q & 1)) { q >>= 1; s++; }
+    uint32_t z = 2;
+    while (powMod32(z, (p - 1) / 2, p) != p - 1) z++;
+    uint64_t c = powMod32(z, q, p), r = powMod32(a, (q + 1) / 2, p);
+    uint64_t t = powMod32(a, q, p);
+    uint32_t m = s;
+    while (t != 1)
+    {
+        uint32_t i = 0;
+        for (uint64_t tt = t; tt != 1; tt = tt * tt % p) i++;
+        uint64_t b = c;
+        for (uint32_t k = 0; k + i + 1 < m; k++) b = b * b % p;
+        r = r * b % p;
+        c = b * b % p;
+        t = t * c % p;
+        m = i;
+    }
+    return uint32_t(r);
+}
+
+class Siqs
+{
+public:
+    explicit Siqs(const mpz_class& n) : n_(n)
+    {
+        chooseMultiplier();
+        chooseParams();
+        buildFactorBase();
+        target_ = fbSize() + kSiqsExtraRelations;
+    }
+
+    // Called by every pool thread that joins. Sieves until there are enough
+    // relations; the first thread to get there then does the linear algebra
+    // while the others return. 1 = 'found' holds a proper factor; 0 = this
+    // thread is done for now (stopped, someone else is solving, or the
+    // algebra failed and raised the relation target: check wantsThreads()).
+    int run(mpz_class& found)
+    {
+        if (trivial_ > 1)
+        {
+            found = trivial_;
+            return 1;
+        }
+        sieveLoop();
+        if (stopAsap()) return 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (solving_ || done_) return 0;
+            solving_ = true;
+        }
+        bool ok = solve(found);
+        std::lock_guard<std::mutex> lock(mutex_);
+        solving_ = false;
+        if (ok || ++attempts_ >= 4)
+        {
+            done_ = true;
+            failed_ = !ok;
+            return ok ? 1 : 0;
+        }
+        // every dependency was trivial: collect a few more and retry
+        target_ += kSiqsExtraRelations + fbSize() / 20;
+        enough_ = false;
+        return 0;
+    }
+
+    bool wantsThreads()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return !done_ && !enough_;
+    }
+
+    bool failed()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return failed_;
+    }
+
+    unsigned fbSize() const { return unsigned(fbP_.size()); }
+    unsigned multiplier() const { return k_; }
+    unsigned relations()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return unsigned(matrixRels_.size());
+    }
+
+private:
+    // One smooth (or partial) value: X = Ax + B mod N, and the factor-base
+    // indices dividing A g(x) with multiplicity (0 stands for -1).
+    struct Relation
+    {
+        mpz_class X;
+        std::vector<uint32_t> factors;
+        unsigned long largePrime = 1;
+    };
+
+    mpz_class n_, kn_, trivial_ = 0;
+    unsigned k_ = 1;
+    unsigned digits_ = 0;
+    SiqsParams params_;
+    unsigned long M_ = 0;
+    double scale_ = 1;
+    uint8_t threshold_ = 0;
+    unsigned long lpBound_ = 0;
+
+    // factor base (index 0 = -1), structure-of-arrays for the sieve loop
+    std::vector<uint32_t> fbP_;
+    std::vector<uint32_t> fbSqrt_;
+    std::vector<uint8_t> fbLog_;
+    unsigned sieveStart_ = 0;       // first index that is sieved
+    unsigned aLo_ = 0, aHi_ = 0;    // index range A's primes come from
+    unsigned s_ = 0;                // primes per A
+
+    std::mutex mutex_;
+    std::set<std::vector<uint32_t>> usedA_;
+    std::vector<Relation> rels_;
+    std::unordered_map<unsigned long, uint32_t> partialByPrime_;
+    std::vector<std::vector<uint32_t>> matrixRels_;   // 1 full or 2 partials
+    unsigned target_ = 0;
+    unsigned attempts_ = 0;
+    bool enough_ = false, solving_ = false, done_ = false, failed_ = false;
+    std::atomic<unsigned> seed_{1};
+
+    // Knuth-Schroeppel: pick k so that kN has many small quadratic residues.
+    void chooseMultiplier()
+    {
+        static const unsigned kCandidates[] = {
+            1, 2, 3, 5, 6, 7, 10, 11, 13, 14, 15, 17, 19, 21, 22, 23, 26, 29,
+            30, 31, 33, 34, 35, 37, 38, 39, 41, 42, 43, 46, 47, 51, 53, 55,
+            57, 58, 59, 61, 62, 65, 66, 67, 69, 70, 71, 73};
+        double best = -1e9;
+        for (unsigned k : kCandidates)
+        {
+            mpz_class kn = n_ * k;
+            double f = -0.5 * std::log(double(k));
+            unsigned m8 = mpz_fdiv_ui(kn.get_mpz_t(), 8);
+            f += (m8 == 1 ? 2.0 : m8 == 5 ? 1.0 : m8 % 2 ? 0.5 : 0.0) * std::log(2.0);
+            for (unsigned long p : smallPrimes())
+            {
+                if (p == 2) continue;
+                if (p > 1000) break;
+                unsigned r = mpz_fdiv_ui(kn.get_mpz_t(), p);
+                if (r == 0)
+                    f += std::log(double(p)) / p;
+                else if (powMod32(r, (p - 1) / 2, p) == 1)
+                    f += 2 * std::log(double(p)) / (p - 1);
+            }
+            if (f > best)
+            {
+                best = f;
+                k_ = k;
+            }
+        }
+        kn_ = n_ * k_;
+    }
+
+    void chooseParams()
+    {
+        digits_ = kn_.get_str().size();
+        const unsigned rows = sizeof(kSiqsParams) / sizeof(kSiqsParams[0]);
+        if (digits_ <= kSiqsParams[0].digits)
+            params_ = kSiqsParams[0];
+        else if (digits_ >= kSiqsParams[rows - 1].digits)
+            params_ = kSiqsParams[rows - 1];
+        else
+        {
+            unsigned i = 0;
+            while (kSiqsParams[i + 1].digits < digits_) i++;
+            const SiqsParams &a = kSiqsParams[i], &b = kSiqsParams[i + 1];
+            double f = double(digits_ - a.digits) / (b.digits - a.digits);
+            params_.digits = digits_;
+            params_.fbSize = unsigned(a.fbSize + f * (double(b.fbSize) - a.fbSize));
+            params_.blocks = unsigned(a.blocks + f * (double(b.blocks) - a.blocks) + 0.5);
+            params_.lpMult = unsigned(a.lpMult + f * (double(b.lpMult) - a.lpMult));
+        }
+        params_.blocks += params_.blocks & 1;   // even: M is a whole number of blocks
+        M_ = (unsigned long)params_.blocks * kSieveBlock / 2;
+    }
+
+    void buildFactorBase()
+    {
+        fbP_.push_back(1);          // -1
+        fbSqrt_.push_back(0);
+        for (unsigned long p : smallPrimes())
+        {
+            if (fbP_.size() > params_.fbSize) break;
+            unsigned r = mpz_fdiv_ui(kn_.get_mpz_t(), p);
+            bool divides = r == 0;
+            if (divides && mpz_divisible_ui_p(n_.get_mpz_t(), p) && n_ != p)
+            {
+                trivial_ = p;       // only if trial division was skipped
+                return;
+            }
+            if (p != 2 && !divides && powMod32(r, (p - 1) / 2, p) != 1) continue;
+            fbP_.push_back(p);
+            fbSqrt_.push_back(p == 2 ? r & 1 : sqrtMod32(r, p));
+        }
+        sieveStart_ = 1;
+        while (sieveStart_ < fbP_.size() && fbP_[sieveStart_] < kSieveMinPrime)
+            sieveStart_++;
+
+        // g(x) peaks near M sqrt(kN/2); scale logs so its size is ~120 units
+        double log2g = std::log2(double(M_)) + 0.5 * (mpz_sizeinbase(kn_.get_mpz_t(), 2) - 1);
+        scale_ = std::min(1.5, 120.0 / log2g);
+        for (uint32_t p : fbP_) fbLog_.push_back(uint8_t(std::lround(std::log2(double(p)) * scale_)));
+        unsigned long pmax = fbP_.back();
+        lpBound_ = pmax * params_.lpMult;
+        // Accept what might leave a cofactor below the large prime bound,
+        // allowing for the unsieved small primes and prime powers.
+        double slack = std::log2(double(lpBound_)) + 2 * std::log2(double(kSieveMinPrime)) + 2;
+        threshold_ = uint8_t(std::max(10.0, (log2g - slack) * scale_));
+
+        // A's primes: around the size that makes s of them hit the target
+        double lnTarget = 0.5 * std::log(2.0) + 0.5 * std::log(kn_.get_d()) - std::log(double(M_));
+        unsigned mid = std::max<unsigned>(sieveStart_ + 2, fbP_.size() / 4);
+        double pMid = std::min(4000.0, double(fbP_[std::min<size_t>(mid, fbP_.size() - 1)]));
+        s_ = std::max(2, int(std::lround(lnTarget / std::log(pMid))));
+        double ideal = std::exp(lnTarget / s_);
+        aLo_ = sieveStart_;
+        while (aLo_ + 1 < fbP_.size() && fbP_[aLo_] < ideal / 2) aLo_++;
+        aHi_ = aLo_;
+        while (aHi_ < fbP_.size() && fbP_[aHi_] < ideal * 2) aHi_++;
+        if (aHi_ - aLo_ < 2 * s_ + 4)
+        {
+            aLo_ = sieveStart_;
+            aHi_ = fbP_.size();
+        }
+    }
+
+    // Picks s factor-base primes whose product is close to sqrt(2kN)/M and
+    // has not been used before: s-1 at random, the last to fix the size.
+    bool chooseA(std::mt19937& rng, mpz_class& A, std::vector<uint32_t>& q)
+    {
+        mpz_class target = sqrt(2 * kn_) / M_;
+        for (int attempt = 0; attempt < 200; attempt++)
+        {
+            q.clear();
+            A = 1;
+            std::uniform_int_distribution<unsigned> pick(aLo_, aHi_ - 1);
+            while (q.size() + 1 < s_)
+            {
+                unsigned i = pick(rng);
+                if (std::find(q.begin(), q.end(), i) != q.end()) continue;
+                q.push_back(i);
+                A *= fbP_[i];
+            }
+            mpz_class want = target / A;
+            if (want < 2) continue;
+            double w = want.get_d();
+            unsigned best = 0;
+            double bestErr = 1e300;
+            for (unsigned i = sieveStart_; i < fbP_.size(); i++)
+            {
+                if (std::find(q.begin(), q.end(), i) != q.end()) continue;
+                double err = std::fabs(std::log(fbP_[i] / w));
+                if (err < bestErr) { bestErr = err; best = i; }
+            }
+            if (best == 0 || bestErr > 0.7) continue;
+            q.push_back(best);
+            A *= fbP_[best];
+            std::sort(q.begin(), q.end());
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (usedA_.insert(q).second) return true;
+        }
+        return false;
+    }
+
+    void sieveLoop()
+    {
+        std::mt19937 rng(seed_.fetch_add(1) * 2654435761u);
+        const unsigned F = fbSize();
+        std::vector<uint32_t> root1(F), root2(F), next1(F), next2(F), ainv(F);
+        std::vector<uint8_t> sieve(kSieveBlock);
+        std::vector<uint8_t> inA(F);
+        std::vector<uint32_t> q;
+        mpz_class A, B, C, gx, X;
+        std::vector<uint32_t> factors;
+
+        while (!stopAsap())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (enough_ || done_) return;
+            }
+            if (!chooseA(rng, A, q)) return;
+            const unsigned s = q.size();
+
+            // B_l = (A/q_l) * (sqrt(kN) * (A/q_l)^-1 mod q_l), the smaller root
+            std::vector<mpz_class> Bl(s);
+            B = 0;
+            for (unsigned l = 0; l < s; l++)
+            {
+                uint32_t ql = fbP_[q[l]];
+                mpz_class Aq = A / ql;
+                uint64_t g = uint64_t(fbSqrt_[q[l]]) *
+                             invMod32(mpz_fdiv_ui(Aq.get_mpz_t(), ql), ql) % ql;
+                if (g > ql / 2) g = ql - g;
+                Bl[l] = Aq * (unsigned long)g;
+                B += Bl[l];
+            }
+            std::fill(inA.begin(), inA.end(), 0);
+            for (unsigned i : q) inA[i] = 1;
+
+            // 2 B_l A^-1 mod p for every sieved prime, and the first roots
+            std::vector<std::vector<uint32_t>> delta(s, std::vector<uint32_t>(F));
+            for (unsigned i = sieveStart_; i < F; i++)
+            {
+                if (inA[i]) continue;
+                uint32_t p = fbP_[i];
+                ainv[i] = invMod32(mpz_fdiv_ui(A.get_mpz_t(), p), p);
+                for (unsigned l = 0; l < s; l++)
+                    delta[l][i] = uint64_t(2 * mpz_fdiv_ui(Bl[l].get_mpz_t(), p)) % p *
+                                  ainv[i] % p;
+                uint32_t b = mpz_fdiv_ui(B.get_mpz_t(), p);
+                uint32_t t = fbSqrt_[i], m = M_ % p;
+                root1[i] = (uint64_t(ainv[i]) * ((t + p - b) % p) + m) % p;
+                root2[i] = (uint64_t(ainv[i]) * ((2 * p - t - b) % p) + m) % p;
+            }
+
+            std::vector<int> sign(s, 1);
+            const unsigned polys = 1u << (s - 1);
+            for (unsigned poly = 0; poly < polys && !stopAsap(); poly++)
+            {
+                if (poly > 0)
+                {
+                    // Gray code: flip the sign of B_(v+1); B_0 stays positive
+                    unsigned v = __builtin_ctz(poly) + 1;
+                    sign[v] = -sign[v];
+                    if (sign[v] > 0) B += 2 * Bl[v]; else B -= 2 * Bl[v];
+                    for (unsigned i = sieveStart_; i < F; i++)
+                    {
+                        if (inA[i]) continue;
+                        uint32_t p = fbP_[i], d = delta[v][i];
+                        // roots move by -/+ 2 B_v A^-1
+                        if (sign[v] > 0)
+                        {
+                            root1[i] = root1[i] >= d ? root1[i] - d : root1[i] + p - d;
+                            root2[i] = root2[i] >= d ? root2[i] - d : root2[i] + p - d;
+                        }
+                        else
+                        {
+                            root1[i] += d; if (root1[i] >= p) root1[i] -= p;
+                            root2[i] += d; if (root2[i] >= p) root2[i] -= p;
+                        }
+                    }
+                }
+                C = (B * B - kn_) / A;
+                for (unsigned i = sieveStart_; i < F; i++)
+                {
+                    next1[i] = root1[i];
+                    next2[i] = root2[i];
+                }
+                sievePolynomial(A, B, C, q, inA, root1, root2, next1, next2, sieve,
+                                gx, X, factors);
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (enough_ || done_) return;
+            }
+        }
+    }
+
+    void sievePolynomial(const mpz_class& A, const mpz_class& B, const mpz_class& C,
+                         const std::vector<uint32_t>& q, const std::vector<uint8_t>& inA,
+                         const std::vector<uint32_t>& root1,
+                         const std::vector<uint32_t>& root2,
+                         std::vector<uint32_t>& next1, std::vector<uint32_t>& next2,
+                         std::vector<uint8_t>& sieve, mpz_class& gx, mpz_class& X,
+                         std::vector<uint32_t>& factors)
+    {
+        const unsigned F = fbSize();
+        const uint8_t init = uint8_t(128 - std::min<int>(threshold_, 127));
+        for (unsigned long base = 0; base < 2 * M_; base += kSieveBlock)
+        {
+            std::memset(sieve.data(), init, kSieveBlock);
+            const uint32_t end = base + kSieveBlock;
+            uint8_t* sv = sieve.data();
+            for (unsigned i = sieveStart_; i < F; i++)
+            {
+                if (inA[i]) continue;
+                const uint32_t p = fbP_[i];
+                const uint8_t lg = fbLog_[i];
+                uint32_t a = next1[i], b = next2[i];
+                for (; a < end; a += p) sv[a - base] += lg;
+                for (; b < end; b += p) sv[b - base] += lg;
+                next1[i] = a;
+                next2[i] = b;
+            }
+            scanBlock(sv, base, A, B, C, q, inA, root1, root2, gx, X, factors);
+        }
+    }
+
+    // Threshold scan: a byte has its top bit set once its log sum passed the
+    // threshold. 64 bytes are tested at a time (SSE2 movemask on x86-64,
+    // word-wise bit tests elsewhere) since hits are rare.
+    void scanBlock(const uint8_t* sv, unsigned long base, const mpz_class& A,
+                   const mpz_class& B, const mpz_class& C,
+                   const std::vector<uint32_t>& q, const std::vector<uint8_t>& inA,
+                   const std::vector<uint32_t>& root1, const std::vector<uint32_t>& root2,
+                   mpz_class& gx, mpz_class& X, std::vector<uint32_t>& factors)
+    {
+        for (unsigned off = 0; off < kSieveBlock; off += 64)
+        {
+#ifdef __SSE2__
+            __m128i v0 = _mm_loadu_si128((const __m128i*)(sv + off));
+            __m128i v1 = _mm_loadu_si128((const __m128i*)(sv + off + 16));
+            __m128i v2 = _mm_loadu_si128((const __m128i*)(sv + off + 32));
+            __m128i v3 = _mm_loadu_si128((const __m128i*)(sv + off + 48));
+            __m128i any = _mm_or_si128(_mm_or_si128(v0, v1), _mm_or_si128(v2, v3));
+            if (!_mm_movemask_epi8(any)) continue;
+#else
+            uint64_t w[8];
+            std::memcpy(w, sv + off, 64);
+            if (!((w[0] | w[1] | w[2] | w[3] | w[4] | w[5] | w[6] | w[7]) &
+                  0x8080808080808080ull))
+                continue;
+#endif
+            for (unsigned j = off; j < off + 64; j++)
+                if (sv[j] & 0x80)
+                    checkCandidate(long(base + j) - long(M_), base + j, A, B, C, q, inA,
+                                   root1, root2, gx, X, factors);
+        }
+    }
+
+    // Trial-divides g(x) over the factor base (only primes whose roots hit
+    // this position, plus the unsieved ones) and files the relation.
+    void checkCandidate(long x, unsigned long pos, const mpz_class& A,
+                        const mpz_class& B, const mpz_class& C,
+                        const std::vector<uint32_t>& q, const std::vector<uint8_t>& inA,
+                        const std::vector<uint32_t>& root1,
+                        const std::vector<uint32_t>& root2, mpz_class& gx,
+                        mpz_class& X, std::vector<uint32_t>& factors)
+    {
+        // g(x) = (A x + 2 B) x + C
+        X = A * x + B;
+        gx = (X + B) * x + C;
+        factors.clear();
+        if (gx < 0)
+        {
+            factors.push_back(0);
+            gx = -gx;
+        }
+        if (gx == 0) return;
+        for (unsigned i : q) factors.push_back(i);   // the A in A g(x)
+
+        auto divideOut = [&](unsigned i) {
+            while (mpz_divisible_ui_p(gx.get_mpz_t(), fbP_[i]))
+            {
+                mpz_divexact_ui(gx.get_mpz_t(), gx.get_mpz_t(), fbP_[i]);
+                factors.push_back(i);
+            }
+        };
+        const unsigned F = fbSize();
+        for (unsigned i = 1; i < F; i++)
+        {
+            if (i < sieveStart_ || inA[i])
+            {
+                divideOut(i);
+                continue;
+            }
+            uint32_t r = pos % fbP_[i];
+            if (r == root1[i] || r == root2[i]) divideOut(i);
+        }
+
+        if (!mpz_fits_ulong_p(gx.get_mpz_t())) return;
+        unsigned long rest = mpz_get_ui(gx.get_mpz_t());
+        if (rest != 1 && (rest > lpBound_ || rest <= fbP_.back())) return;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (enough_) return;
+        Relation rel;
+        rel.X = X % n_;
+        if (rel.X < 0) rel.X += n_;
+        rel.factors = factors;
+        rel.largePrime = rest;
+        uint32_t idx = rels_.size();
+        if (rest == 1)
+        {
+            rels_.push_back(std::move(rel));
+            matrixRels_.push_back({idx});
+        }
+        else
+        {
+            auto it = partialByPrime_.find(rest);
+            if (it == partialByPrime_.end())
+            {
+                rels_.push_back(std::move(rel));
+                partialByPrime_[rest] = idx;
+            }
+            else
+            {
+                rels_.push_back(std::move(rel));
+                matrixRels_.push_back({it->second, idx});
+            }
+        }
+        if (matrixRels_.size() >= target_) enough_ = true;
+    }
+
+    // Finds GF(2) dependencies among the matrix relations and tries each
+    // one; true with a proper factor in 'found'.
+    bool solve(mpz_class& found)
+    {
+        std::vector<std::vector<uint32_t>> mrels;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            mrels = matrixRels_;
+        }
+        const unsigned F = fbSize();
+
+        // Rows: odd-exponent columns of each matrix relation, with the list
+        // of matrix relations they are made of (merges concatenate them).
+        struct Row { std::vector<uint32_t> cols; std::vector<uint32_t> hist; };
+        std::vector<Row> rows(mrels.size());
+        std::vector<uint8_t> parity(F);
+        for (size_t r = 0; r < mrels.size(); r++)
+        {
+            std::fill(parity.begin(), parity.end(), 0);
+            for (uint32_t ri : mrels[r])
+                for (uint32_t f : rels_[ri].factors) parity[f] ^= 1;
+            for (unsigned c = 0; c < F; c++)
+                if (parity[c]) rows[r].cols.push_back(c);
+            rows[r].hist.push_back(r);
+        }
+
+        // Structured Gaussian elimination: drop rows holding a column no
+        // other row has, merge the two rows of every weight-2 column.
+        std::vector<bool> alive(rows.size(), true);
+        for (int pass = 0; pass < 50; pass++)
+        {
+            std::vector<std::vector<uint32_t>> colRows(F);
+            for (size_t r = 0; r < rows.size(); r++)
+                if (alive[r])
+                    for (uint32_t c : rows[r].cols) colRows[c].push_back(r);
+            bool changed = false;
+            std::vector<bool> touched(rows.size(), false);
+            for (unsigned c = 0; c < F; c++)
+            {
+                if (colRows[c].size() == 1 && alive[colRows[c][0]])
+                {
+                    alive[colRows[c][0]] = false;
+                    changed = true;
+                }
+                else if (colRows[c].size() == 2)
+                {
+                    uint32_t a = colRows[c][0], b = colRows[c][1];
+                    if (!alive[a] || !alive[b] || touched[a] || touched[b]) continue;
+                    std::vector<uint32_t> cols;
+                    std::set_symmetric_difference(rows[a].cols.begin(), rows[a].cols.end(),
+                                                  rows[b].cols.begin(), rows[b].cols.end(),
+                                                  std::back_inserter(cols));
+                    rows[a].cols.swap(cols);
+                    rows[a].hist.insert(rows[a].hist.end(), rows[b].hist.begin(),
+                                        rows[b].hist.end());
+                    alive[b] = false;
+                    touched[a] = true;
+                    changed = true;
+                }
+            }
+            if (!changed) break;
+        }
+
+        std::vector<uint32_t> live;
+        std::vector<int> colIndex(F, -1);
+        unsigned ncols = 0;
+        for (size_t r = 0; r < rows.size(); r++)
+        {
+            if (!alive[r]) continue;
+            live.push_back(r);
+            for (uint32_t c : rows[r].cols)
+                if (colIndex[c] < 0) colIndex[c] = ncols++;
+        }
+        const size_t nr = live.size();
+        if (nr == 0) return false;
+
+        // Dense elimination; each row carries a bitset of which live rows
+        // it is the sum of, so zero rows give dependencies directly.
+        const size_t cw = (ncols + 63) / 64, hw = (nr + 63) / 64, w = cw + hw;
+        std::vector<uint64_t> mat(nr * w, 0);
+        for (size_t r = 0; r < nr; r++)
+        {
+            uint64_t* row = &mat[r * w];
+            for (uint32_t c : rows[live[r]].cols)
+                row[colIndex[c] / 64] |= 1ull << (colIndex[c] % 64);
+            row[cw + r / 64] |= 1ull << (r % 64);
+        }
+        size_t pivotRow = 0;
+        for (unsigned c = 0; c < ncols && pivotRow < nr; c++)
+        {
+            const size_t word = c / 64;
+            const uint64_t bit = 1ull << (c % 64);
+            size_t p = pivotRow;
+            while (p < nr && !(mat[p * w + word] & bit)) p++;
+            if (p == nr) continue;
+            if (p != pivotRow)
+                std::swap_ranges(&mat[p * w], &mat[p * w] + w, &mat[pivotRow * w]);
+            const uint64_t* pr = &mat[pivotRow * w];
+            for (size_t r = pivotRow + 1; r < nr; r++)
+            {
+                uint64_t* row = &mat[r * w];
+                if (!(row[word] & bit)) continue;
+                for (size_t k = word; k < w; k++) row[k] ^= pr[k];
+            }
+            pivotRow++;
+        }
+
+        for (size_t r = pivotRow; r < nr; r++)
+        {
+            // combine: which original relations appear an odd number of times
+            std::vector<uint32_t> count(mrels.size(), 0);
+            const uint64_t* hist = &mat[r * w + cw];
+            for (size_t k = 0; k < nr; k++)
+                if (hist[k / 64] >> (k % 64) & 1)
+                    for (uint32_t m : rows[live[k]].hist) count[m] ^= 1;
+            std::vector<uint32_t> relSet;
+            for (size_t m = 0; m < mrels.size(); m++)
+                if (count[m])
+                    relSet.insert(relSet.end(), mrels[m].begin(), mrels[m].end());
+            if (relSet.empty()) continue;
+            if (trySquareRoot(relSet, found)) return true;
+        }
+        return false;
+    }
+
+    // X = prod (A x + B), Y = sqrt(prod A g(x)) from the exponent sums;
+    // gcd(X - Y, N) splits N for about half of all dependencies.
+    bool trySquareRoot(const std::vector<uint32_t>& relSet, mpz_class& found)
+    {
+        std::vector<uint32_t> exps(fbSize(), 0);
+        std::unordered_map<unsigned long, unsigned> large;
+        mpz_class X = 1, Y = 1;
+        for (uint32_t ri : relSet)
+        {
+            const Relation& r = rels_[ri];
+            X = X * r.X % n_;
+            for (uint32_t f : r.factors) exps[f]++;
+            if (r.largePrime > 1) large[r.largePrime]++;
+        }
+        for (unsigned i = 1; i < fbSize(); i++)
+        {
+            if (exps[i] & 1) return false;
+            if (exps[i] == 0) continue;
+            mpz_class p = fbP_[i], e;
+            mpz_powm_ui(e.get_mpz_t(), p.get_mpz_t(), exps[i] / 2, n_.get_mpz_t());
+            Y = Y * e % n_;
+        }
+        for (const auto& lp : large)
+        {
+            if (lp.second & 1) return false;
+            mpz_class p = lp.first, e;
+            mpz_powm_ui(e.get_mpz_t(), p.get_mpz_t(), lp.second / 2, n_.get_mpz_t());
+            Y = Y * e % n_;
+        }
+        mpz_class g = gcd(X - Y, n_);
+        if (g > 1 && g < n_)
+        {
+            found = g;
+            return true;
+        }
+        return false;
+    }
+};
+
+// One number handed to the program. It is done when every piece has been
+// proven prime or has exhausted its ECM budget, and is handed back only
+// once no unit of any of its jobs is still out (a straggler on a split job
+// still points here).
+struct Input
+{
+    unsigned id = 0;
+    mpz_class n;
+    std::vector<mpz_class> primes;       // with multiplicity
+    std::vector<mpz_class> composites;   // left over when the ladder ran out
+    unsigned pendingJobs = 0;
+    unsigned unitsOut = 0;               // units of its jobs not yet booked
+    unsigned curves = 0;                 // completed ECM curves, all jobs
+    std::chrono::steady_clock::time_point start;
+};
+
+// A composite cofactor still waiting to be split. Everything except 'stop'
+// is guarded by the scheduler mutex.
+struct Job
+{
+    unsigned id = 0;
+    Input* input = nullptr;
+    mpz_class n;
+    unsigned long sigmaBase = 0;
+    std::atomic_bool stop{false};   // set when n splits; aborts units in flight
+    unsigned cheapTodo = 0;         // bit k: cheap unit k still to hand out
+    unsigned cheapEmpty = 0;        // bit k: cheap unit k ran to its budget
+    unsigned cheapRunning = 0;
+    unsigned running = 0;
+    unsigned numLevels = 0;
+    unsigned levelStart[kNumLevels + 1] = {};
+    unsigned levelDone[kNumLevels] = {};
+    std::vector<bool> curveDone;    // per schedule index; drives checkpoints
+    unsigned nextCurve = 0;
+    std::vector<unsigned> retryCurves;  // handed back by lost remote workers
+    bool useSiqs = false;           // ladder is cut short and SIQS finishes
+    std::shared_ptr<Siqs> siqs;     // created once the ladder is handed out
+
+    unsigned totalCurves() const { return levelStart[numLevels]; }
+};
+typedef std::shared_ptr<Job> JobPtr;
+
+// Everything a worker can be handed. The cheap units (rho, P-1, P+1) are
+// dispensed first and run side by side; ECM curves on the same job start
+// only once all of them have come back empty. A SIQS unit is one thread
+// joining the job's sieve; any number of them can run at once.
+enum UnitKind { UNIT_RHO, UNIT_PM1, UNIT_PP1, UNIT_ECM, UNIT_SIQS };
+static const unsigned kNumCheapUnits = 3;
+static const unsigned kAllCheapUnits = (1u << kNumCheapUnits) - 1;
+
+struct WorkUnit
+{
+    JobPtr job;
+    UnitKind kind;
+    unsigned level;   // ECM only
+    unsigned curve;   // ECM only: index into the job's whole schedule
+};
+
+// A copy of one live job's progress, taken under the scheduler lock.
+struct JobSnapshot
+{
+    unsigned id;
+    unsigned inputId;
+    unsigned digits;
+    unsigned numLevels;
+    unsigned levelDone[kNumLevels];
+};
+
+// The worker pool's single source of work. Jobs are served oldest first, so
+// one number gets every thread and later ones fill the gaps (e.g. while a
+// job's cheap stages are still out). Within a job, ECM curve indices are
+// handed out in order, so no level-L+1 curve starts before every level-L
+// curve has been taken.
+class Scheduler
+{
+public:
+    unsigned maxDigits = 0;
+    unsigned maxSiqsDigits = kSiqsMaxDigits;   // 0 = ECM only
+    unsigned long sigmaBase = 0;
+
+    // Trial-divides the input and queues whatever is left, first cut into
+    // coprime pieces along any divisors already known (e.g. from batch GCD).
+    void submit(Input* in, const std::vector<mpz_class>& divisors = {})
+    {
+        in->start = std::chrono::steady_clock::now();
+        mpz_class rest = in->n;
+        std::vector<mpz_class> found;
+        trialDivide(rest, found);
+        std::vector<mpz_class> pieces(1, rest);
+        for (const mpz_class& d : divisors)
+        {
+            std::vector<mpz_class> next;
+            for (const mpz_class& m : pieces)
+            {
+                mpz_class g = gcd(m, d);
+                if (g == 1 || g == m)
+                {
+                    next.push_back(m);
+                    continue;
+                }
+                next.push_back(g);
+                next.push_back(m / g);
+            }
+            pieces.swap(next);
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        openInput(in);
+        in->primes = found;
+        for (const mpz_class& m : pieces)
+            addCofactor(in, m, 0, kAllCheapUnits);
+        releaseJob(in);
+        cv_.notify_all();
+    }
+
+    // No more inputs will be submitted; workers exit once the queue drains.
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        cv_.notify_all();
+        doneCv_.notify_all();
+    }
+
+    // Accepts inputs again once a closed queue has drained (benchmark runs
+    // one pool after another).
+    void reopen()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = false;
+    }
+
+    // Remote workers pass allowSiqs = false: sieving needs the job's
+    // in-process relation store.
+    bool next(WorkUnit& u, bool allowSiqs = true)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;)
+        {
+            for (const JobPtr& j : jobs_)
+            {
+                if (j->stop.load()) continue;
+                if (j->cheapTodo)
+                {
+                    u.kind = UnitKind(__builtin_ctz(j->cheapTodo));
+                    j->cheapTodo &= j->cheapTodo - 1;
+                    j->cheapRunning++;
+                }
+                else if (j->cheapRunning > 0)
+                {
+                    continue;
+                }
+                else if (!j->retryCurves.empty() || skipDoneCurves(*j))
+                {
+                    u.kind = UNIT_ECM;
+                    if (!j->retryCurves.empty())
+                    {
+                        u.curve = j->retryCurves.back();
+                        j->retryCurves.pop_back();
+                    }
+                    else
+                    {
+                        u.curve = j->nextCurve++;
+                    }
+                    u.level = std::upper_bound(j->levelStart,
+                                               j->levelStart + j->numLevels,
+                                               u.curve) - j->levelStart - 1;
+                }
+                else if (j->useSiqs && allowSiqs)
+                {
+                    // the last curves may still be out; the sieve need not wait
+                    if (!j->siqs)
+                    {
+                        j->siqs = std::make_shared<Siqs>(j->n);
+                        if (g_verbose)
+                        {
+                            std::lock_guard<std::mutex> logLock(g_logMutex);
+                            std::cout << "  job " << j->id << ": SIQS, multiplier "
+                                      << j->siqs->multiplier() << ", "
+                                      << j->siqs->fbSize() << " primes\n";
+                        }
+                    }
+                    if (!j->siqs->wantsThreads()) continue;
+                    u.kind = UNIT_SIQS;
+                }
+                else
+                {
+                    continue;
+                }
+                u.job = j;
+                j->running++;
+                j->input->unitsOut++;
+                return true;
+            }
+            if (closed_ && jobs_.empty()) return false;
+            cv_.wait(lock);
+        }
+    }
+
+    // Books a finished unit. A factor splits the job into cofactor jobs (or
+    // primes); a job whose ladder is used up is recorded as unfactored.
+    void complete(const WorkUnit& u, int ret, const mpz_class& found)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Job& j = *u.job;
+        Input* in = j.input;
+        j.running--;
+        // Once a job has split or been retired, whatever its units report is
+        // void: a late factor is found again by the cofactor jobs, and the
+        // input may already be settled.
+        bool aborted = j.stop.load();
+        if (u.kind < kNumCheapUnits)
+        {
+            j.cheapRunning--;
+            if (ret == 0 && !aborted) j.cheapEmpty |= 1u << u.kind;
+        }
+
+        if (u.kind == UNIT_ECM && !aborted)
+        {
+            in->curves++;
+            j.curveDone[u.curve] = true;
+            g_levelCurves[u.level]++;
+            if (++j.levelDone[u.level] == kLevels[u.level].curves && g_verbose)
+            {
+                std::lock_guard<std::mutex> logLock(g_logMutex);
+                std::cout << "  job " << j.id << ": " << kLevels[u.level].digits
+                          << "-digit level done (" << kLevels[u.level].curves
+                          << " curves)\n";
+            }
+        }
+
+        if (aborted)
+        {
+            // nothing to settle: the job is already out of the queue
+        }
+        else if (ret > 0 && found > 1 && found < j.n)
+        {
+            j.stop = true;
+            removeJob(u.job);
+            // Work that ran to completion on n covers its divisors too (the
+            // rho sequence and every curve look the same mod p), so the
+            // pieces pick up the ladder where n left it and only redo the
+            // cheap methods that were cut short.
+            unsigned firstLevel = 0;
+            while (firstLevel < j.numLevels &&
+                   j.levelDone[firstLevel] >= kLevels[firstLevel].curves)
+                firstLevel++;
+            unsigned cheap = kAllCheapUnits & ~j.cheapEmpty;
+            addCofactor(in, found, firstLevel, cheap);
+            addCofactor(in, j.n / found, firstLevel, cheap);
+            releaseJob(in);
+        }
+        else
+        {
+            settleIfExhausted(u.job);
+        }
+        unitBooked(in);
+        cv_.notify_all();
+    }
+
+    // Takes back a unit that will never complete (its remote worker went
+    // away), so that next() hands it out again.
+    void requeue(const WorkUnit& u)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Job& j = *u.job;
+        j.running--;
+        if (u.kind < kNumCheapUnits)
+        {
+            j.cheapRunning--;
+            j.cheapTodo |= 1u << u.kind;
+        }
+        else if (u.kind == UNIT_ECM)
+        {
+            j.retryCurves.push_back(u.curve);
+        }
+        unitBooked(j.input);
+        cv_.notify_all();
+    }
+
+    // Blocks until some inputs have settled and hands them over in
+    // completion order. Returns false once the queue is closed and every
+    // submitted input has been handed over.
+    bool waitFinished(std::vector<Input*>& out)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        doneCv_.wait(lock, [this] {
+            return !finished_.empty() || (closed_ && inputsOpen_ == 0);
+        });
+        out.clear();
+        out.swap(finished_);
+        return !out.empty();
+    }
+
+    std::vector<JobSnapshot> snapshot()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<JobSnapshot> out;
+        for (const JobPtr& j : jobs_)
+        {
+            JobSnapshot v;
+            v.id = j->id;
+            v.inputId = j->input->id;
+            v.digits = j->n.get_str().size();
+            v.numLevels = j->numLevels;
+            std::copy(j->levelDone, j->levelDone + kNumLevels, v.levelDone);
+            out.push_back(v);
+        }
+        return out;
+    }
+
+    // Writes every open input with its known factors and, per live job, the
+    // sigma base, which cheap methods ran empty, and which sigmas have been
+    // completed at each level. Curves still in flight are not recorded and
+    // simply run again after a resume.
+    void checkpoint(std::ostream& out)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out << "ecm-checkpoint 1\n";
+        out << "sigma " << sigmaBase << "\n";
+        out << "nextjob " << nextJobId_ << "\n";
+        std::sort(finishedIds_.begin(), finishedIds_.end());
+        out << "finished " << formatRanges(finishedIds_) << "\n";
+        for (Input* in : open_)
+        {
+            out << "input " << in->id << " " << in->curves << " "
+                << in->n.get_str() << "\n";
+            for (const mpz_class& p : in->primes)
+                out << "prime " << p.get_str() << "\n";
+            for (const mpz_class& c : in->composites)
+                out << "composite " << c.get_str() << "\n";
+            for (const JobPtr& j : jobs_)
+            {
+                if (j->input != in) continue;
+                out << "job " << j->sigmaBase << " " << j->cheapEmpty << " "
+                    << j->n.get_str() << "\n";
+                for (unsigned l = 0; l < j->numLevels; l++)
+                {
+                    std::vector<unsigned long> sigmas;
+                    for (unsigned c = j->levelStart[l]; c < j->levelStart[l + 1]; c++)
+                        if (j->curveDone[c]) sigmas.push_back(j->sigmaBase + c);
+                    out << "level " << kLevels[l].digits << " " << kLevels[l].B1
+                        << " " << j->levelDone[l] << " " << formatRanges(sigmas)
+                        << "\n";
+                }
+            }
+        }
+        out << "end\n";
+    }
+
+    // Rebuilds inputs and jobs from a checkpoint. Restored inputs are open
+    // in the scheduler and appended to 'restored'; ids of inputs that had
+    // already finished go to 'finishedIds'. Returns false (and changes
+    // nothing) on a missing or truncated file.
+    bool restore(std::istream& src, std::vector<Input*>& restored,
+                 std::vector<unsigned long>& finishedIds)
+    {
+        std::string line, key;
+        if (!std::getline(src, line) || line != "ecm-checkpoint 1") return false;
+        std::vector<std::string> lines;
+        bool complete = false;
+        while (std::getline(src, line))
+        {
+            if (line == "end") { complete = true; break; }
+            lines.push_back(line);
+        }
+        if (!complete) return false;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        Input* in = nullptr;
+        JobPtr job;
+        std::vector<Input*> mine;
+        for (const std::string& l : lines)
+        {
+            std::istringstream ls(l);
+            ls >> key;
+            if (key == "sigma")
+                ls >> sigmaBase;
+            else if (key == "nextjob")
+                ls >> nextJobId_;
+            else if (key == "finished")
+            {
+                std::string r;
+                ls >> r;
+                parseRanges(r, finishedIds_);
+            }
+            else if (key == "input")
+            {
+                std::string n;
+                in = new Input;
+                ls >> in->id >> in->curves >> n;
+                in->n = mpz_class(n);
+                in->start = std::chrono::steady_clock::now();
+                openInput(in);
+                mine.push_back(in);
+                job.reset();
+            }
+            else if (key == "prime" && in)
+            {
+                std::string p;
+                ls >> p;
+                in->primes.push_back(mpz_class(p));
+            }
+            else if (key == "composite" && in)
+            {
+                std::string c;
+                ls >> c;
+                in->composites.push_back(mpz_class(c));
+            }
+            else if (key == "job" && in)
+            {
+                unsigned long base;
+                unsigned empty;
+                std::string n;
+                ls >> base >> empty >> n;
+                job = makeJob(in, mpz_class(n), 0, kAllCheapUnits & ~empty);
+                job->sigmaBase = base;
+                job->cheapEmpty = empty;
+                std::fill(job->levelDone, job->levelDone + kNumLevels, 0);
+                job->curveDone.assign(job->totalCurves(), false);
+            }
+            else if (key == "level" && job)
+            {
+                unsigned digits, done;
+                double B1;
+                std::string r;
+                ls >> digits >> B1 >> done >> r;
+                unsigned lv = 0;
+                while (lv < job->numLevels && kLevels[lv].digits != digits) lv++;
+                if (lv == job->numLevels) continue;
+                unsigned first = job->levelStart[lv], last = job->levelStart[lv + 1];
+                if (done >= kLevels[lv].curves)
+                {
+                    // finished, possibly inherited from a parent job
+                    std::fill(job->curveDone.begin() + first,
+                              job->curveDone.begin() + last, true);
+                    job->levelDone[lv] = kLevels[lv].curves;
+                    continue;
+                }
+                std::vector<unsigned long> sigmas;
+                parseRanges(r, sigmas);
+                for (unsigned long sg : sigmas)
+                {
+                    if (sg < job->sigmaBase + first || sg >= job->sigmaBase + last)
+                        continue;
+                    unsigned c = sg - job->sigmaBase;
+                    if (!job->curveDone[c]) job->levelDone[lv]++;
+                    job->curveDone[c] = true;
+                }
+            }
+        }
+
+        for (Input* r : mine)
+        {
+            std::vector<JobPtr> own;
+            for (const JobPtr& j : jobs_)
+                if (j->input == r) own.push_back(j);
+            for (const JobPtr& j : own)
+            {
+                j->nextCurve = 0;
+                settleIfExhausted(j);
+            }
+            releaseJob(r);
+            restored.push_back(r);
+        }
+        finishedIds.insert(finishedIds.end(), finishedIds_.begin(),
+                           finishedIds_.end());
+        cv_.notify_all();
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable doneCv_;
+    std::list<JobPtr> jobs_;
+    std::list<Input*> open_;
+    std::vector<Input*> finished_;
+    std::vector<unsigned long> finishedIds_;
+    unsigned inputsOpen_ = 0;
+    unsigned nextJobId_ = 0;
+    bool closed_ = false;
+
+    void openInput(Input* in)
+    {
+        inputsOpen_++;
+        open_.push_back(in);
+        in->pendingJobs = 1;     // held until its first jobs are queued
+    }
+
+    void removeJob(const JobPtr& job)
+    {
+        jobs_.remove(job);
+    }
+
+    void releaseJob(Input* in)
+    {
+        if (--in->pendingJobs > 0 || in->unitsOut > 0) return;
+        finishInput(in);
+    }
+
+    // The last unit of a settled input has come back.
+    void unitBooked(Input* in)
+    {
+        if (--in->unitsOut > 0 || in->pendingJobs > 0) return;
+        finishInput(in);
+    }
+
+    void finishInput(Input* in)
+    {
+        finished_.push_back(in);
+        finishedIds_.push_back(in->id);
+        open_.remove(in);
+        inputsOpen_--;
+        doneCv_.notify_all();
+    }
+
+    // Moves nextCurve past curves a resumed checkpoint already covered;
+    // false when the job has no ECM curve left to hand out.
+    static bool skipDoneCurves(Job& j)
+    {
+        while (j.nextCurve < j.totalCurves() && j.curveDone[j.nextCurve])
+            j.nextCurve++;
+        return j.nextCurve < j.totalCurves();
+    }
+
+    // Retires a job whose cheap methods, ladder and (if chosen) SIQS are all
+    // used up.
+    void settleIfExhausted(const JobPtr& job)
+    {
+        Job& j = *job;
+        if (j.stop.load() || j.running > 0 || j.cheapTodo != 0 ||
+            !j.retryCurves.empty() || skipDoneCurves(j))
+            return;
+        if (j.useSiqs && !(j.siqs && j.siqs->failed()))
+            return;
+        j.stop = true;
+        removeJob(job);
+        j.input->composites.push_back(j.n);
+        releaseJob(j.input);
+    }
+
+    // Files m under its input: 1 is dropped, primes and perfect powers are
+    // resolved on the spot, anything else becomes a new job.
+    void addCofactor(Input* in, const mpz_class& m, unsigned firstLevel,
+                     unsigned cheap)
+    {
+        if (m == 1) return;
+        if (isProbablePrimeBPSW(m))
+        {
+            in->primes.push_back(m);
+            return;
+        }
+        if (mpz_perfect_power_p(m.get_mpz_t()))
+        {
+            // ECM cannot split p^k; take the largest exact root instead
+            for (unsigned long k = mpz_sizeinbase(m.get_mpz_t(), 2); k >= 2; k--)
+            {
+                mpz_class root;
+                if (mpz_root(root.get_mpz_t(), m.get_mpz_t(), k))
+                {
+                    for (unsigned long i = 0; i < k; i++)
+                        addCofactor(in, root, firstLevel, cheap);
+                    return;
+                }
+            }
+        }
+        makeJob(in, m, firstLevel, cheap);
+    }
+
+    JobPtr makeJob(Input* in, const mpz_class& m, unsigned firstLevel,
+                   unsigned cheap)
+    {
+        JobPtr j = std::make_shared<Job>();
+        j->id = nextJobId_++;
+        j->input = in;
+        j->n = m;
+        j->sigmaBase = sigmaBase + ((unsigned long)j->id << kSigmaBlockBits);
+        j->cheapTodo = cheap;
+
+        // The smallest factor of a composite has at most half its digits, so
+        // levels beyond that can never pay off. In SIQS range ECM only clears
+        // out factors up to ~2/7 of the size, where a curve set still costs
+        // less than the sieve; past that a balanced split is the likely case.
+        unsigned digits = m.get_str().size();
+        unsigned cap = maxDigits ? maxDigits : (digits + 1) / 2;
+        j->useSiqs = digits >= kSiqsMinDigits && digits <= maxSiqsDigits;
+        if (j->useSiqs) cap = std::min(cap, digits * 2 / 7);
+        while (j->numLevels < kNumLevels &&
+               (j->numLevels == 0 || kLevels[j->numLevels].digits <= cap))
+        {
+            j->levelStart[j->numLevels + 1] =
+                j->levelStart[j->numLevels] + kLevels[j->numLevels].curves;
+            j->numLevels++;
+        }
+        // always leave the piece at least its top level of fresh curves,
+        // unless SIQS takes over from there anyway
+        firstLevel = std::min(firstLevel, j->numLevels - (j->useSiqs ? 0 : 1));
+        j->curveDone.assign(j->totalCurves(), false);
+        for (unsigned l = 0; l < firstLevel; l++)
+            j->levelDone[l] = kLevels[l].curves;
+        std::fill(j->curveDone.begin(),
+                  j->curveDone.begin() + j->levelStart[firstLevel], true);
+        j->nextCurve = j->levelStart[firstLevel];
+
+        if (g_verbose)
+        {
+            std::lock_guard<std::mutex> logLock(g_logMutex);
+            std::cout << "  job " << j->id << ": " << m.get_str() << " ("
+                      << m.get_str().size() << " digits), "
+                      << (cheap ? "cheap methods then " : "")
+                      << (firstLevel < j->numLevels
+                              ? "ECM from the " + std::to_string(kLevels[firstLevel].digits) +
+                                    "-digit level, sigma base " + std::to_string(j->sigmaBase)
+                              : std::string("no ECM"))
+                      << (j->useSiqs ? ", then SIQS" : "") << "\n";
+        }
+        in->pendingJobs++;
+        jobs_.push_back(j);
+        return j;
+    }
+};
+
+Scheduler g_sched;
+
+// Pollard rho with Brent's cycle finding. Differences are multiplied into q
+// and only every 'm' steps is a gcd taken; if a batch overshoots to gcd == N
+// the last batch is replayed one step at a time from the saved ys.
+static bool pollardBrent(const mpz_class& N, unsigned long c,
+                         unsigned long maxIter, mpz_class& factor)
+{
+    const unsigned long m = 256;
+    mpz_class x, y = 2, ys, q = 1, g = 1, diff;
+    unsigned long r = 1, iter = 0;
+
+    auto step = [&](mpz_class& v) {
+        mpz_mul(v.get_mpz_t(), v.get_mpz_t(), v.get_mpz_t());
+        mpz_add_ui(v.get_mpz_t(), v.get_mpz_t(), c);
+        mpz_mod(v.get_mpz_t(), v.get_mpz_t(), N.get_mpz_t());
+    };
+
+    while (g == 1 && iter < maxIter)
+    {
+        x = y;
+        for (unsigned long i = 0; i < r; i++) step(y);
+        for (unsigned long k = 0; k < r && g == 1; k += m)
+        {
+            if (stopAsap()) return false;
+            ys = y;
+            unsigned long batch = std::min(m, r - k);
+            for (unsigned long i = 0; i < batch; i++)
+            {
+                step(y);
+                diff = x - y;
+                mpz_mul(q.get_mpz_t(), q.get_mpz_t(), diff.get_mpz_t());
+                mpz_mod(q.get_mpz_t(), q.get_mpz_t(), N.get_mpz_t());
+            }
+            mpz_gcd(g.get_mpz_t(), q.get_mpz_t(), N.get_mpz_t());
+            iter += batch;
+        }
+        r *= 2;
+    }
+    if (g == N)
+    {
+        do
+        {
+            step(ys);
+            diff = x - ys;
+            mpz_gcd(g.get_mpz_t(), diff.get_mpz_t(), N.get_mpz_t());
+        } while (g == 1);
+    }
+    if (g == 1 || g == N) return false;
+    factor = g;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Fixed-width Montgomery arithmetic and an in-house ECM stage 1 for N below
+// 2^256. GMP-ECM's mpz layer costs more in dispatch and normalisation than
+// in arithmetic at two to four limbs; here every residue is a plain array of
+// L words, multiplication is word-by-word Montgomery (CIOS) with __int128
+// products, and the loops have compile-time bounds so they unroll.
+// ---------------------------------------------------------------------------
+
+bool g_edwards = true;          // -E turns the in-house stage 1 off
+bool g_edwardsCheck = false;    // -X: compare every stage 1 with GMP-ECM's
+std::atomic<unsigned long> g_edwardsMismatches{0};
+
+static const unsigned kMaxMontLimbs = 4;
+static const unsigned kScalarChunkBits = 4096;
+static const unsigned kWindowBits = 5;      // wNAF width: 8 precomputed points
+
+template <unsigned L>
+struct MontArith
+{
+    uint64_t n[L];
+    uint64_t ninv;      // -n^-1 mod 2^64
+    uint64_t r2[L];     // R^2 mod n, R = 2^(64 L)
+
+    explicit MontArith(const mpz_class& N)
+    {
+        toWords(N, n);
+        uint64_t inv = 1;
+        for (int i = 0; i < 6; i++) inv *= 2 - n[0] * inv;    // Newton, 2^64
+        ninv = 0 - inv;
+        mpz_class r2z = 1;
+        r2z <<= 128 * L;
+        r2z %= N;
+        toWords(r2z, r2);
+    }
+
+    static void toWords(const mpz_class& x, uint64_t* w)
+    {
+        std::fill(w, w + L, 0);
+        mpz_export(w, nullptr, -1, sizeof(uint64_t), 0, 0, x.get_mpz_t());
+    }
+
+    static mpz_class fromWords(const uint64_t* w)
+    {
+        mpz_class x;
+        mpz_import(x.get_mpz_t(), L, -1, sizeof(uint64_t), 0, 0, w);
+        return x;
+    }
+
+    // r = a b / R mod n, inputs and output in [0, n); r may alias a or b
+    void mul(uint64_t* r, const uint64_t* a, const uint64_t* b) const
+    {
+        uint64_t t[L + 2] = {};
+#pragma GCC unroll 4
+        for (unsigned i = 0; i < L; i++)
+        {
+            unsigned __int128 c = 0;
+#pragma GCC unroll 4
+            for (unsigned j = 0; j < L; j++)
+            {
+                c += (unsigned __int128)a[j] * b[i] + t[j];
+                t[j] = (uint64_t)c;
+                c >>= 64;
+            }
+            c += t[L];
+            t[L] = (uint64_t)c;
+            t[L + 1] = (uint64_t)(c >> 64);
+
+            uint64_t m = t[0] * ninv;
+            c = ((unsigned __int128)m * n[0] + t[0]) >> 64;
+#pragma GCC unroll 4
+            for (unsigned j = 1; j < L; j++)
+            {
+                c += (unsigned __int128)m * n[j] + t[j];
+                t[j - 1] = (uint64_t)c;
+                c >>= 64;
+            }
+            c += t[L];
+            t[L - 1] = (uint64_t)c;
+            t[L] = t[L + 1] + (uint64_t)(c >> 64);
+        }
+        reduceOnce(r, t, t[L]);
+    }
+
+    void add(uint64_t* r, const uint64_t* a, const uint64_t* b) const
+    {
+        uint64_t t[L];
+        unsigned char carry = 0;
+#pragma GCC unroll 4
+        for (unsigned j = 0; j < L; j++)
+        {
+            unsigned __int128 s = (unsigned __int128)a[j] + b[j] + carry;
+            t[j] = (uint64_t)s;
+            carry = (unsigned char)(s >> 64);
+        }
+        reduceOnce(r, t, carry);
+    }
+
+    void sub(uint64_t* r, const uint64_t* a, const uint64_t* b) const
+    {
+        uint64_t t[L];
+        unsigned char borrow = 0;
+#pragma GCC unroll 4
+        for (unsigned j = 0; j < L; j++)
+        {
+            unsigned __int128 s = (unsigned __int128)a[j] - b[j] - borrow;
+            t[j] = (uint64_t)s;
+            borrow = (unsigned char)(s >> 64) & 1;
+        }
+        if (borrow)
+        {
+            unsigned char carry = 0;
+#pragma GCC unroll 4
+            for (unsigned j = 0; j < L; j++)
+            {
+                unsigned __int128 s = (unsigned __int128)t[j] + n[j] + carry;
+                t[j] = (uint64_t)s;
+                carry = (unsigned char)(s >> 64);
+            }
+        }
+        std::copy(t, t + L, r);
+    }
+
+    void neg(uint64_t* r, const uint64_t* a) const
+    {
+        uint64_t zero[L] = {};
+        sub(r, zero, a);
+    }
+
+    void toMont(uint64_t* r, const mpz_class& x) const
+    {
+        uint64_t w[L];
+        toWords(x, w);
+        mul(r, w, r2);
+    }
+
+    mpz_class fromMont(const uint64_t* a) const
+    {
+        uint64_t one[L] = {1}, w[L];
+        mul(w, a, one);
+        return fromWords(w);
+    }
+
+private:
+    // r = t - n if the (L+1)-word value hi:t is at least n, else t
+    void reduceOnce(uint64_t* r, const uint64_t* t, uint64_t hi) const
+    {
+        uint64_t d[L];
+        unsigned char borrow = 0;
+#pragma GCC unroll 4
+        for (unsigned j = 0; j < L; j++)
+        {
+            unsigned __int128 s = (unsigned __int128)t[j] - n[j] - borrow;
+            d[j] = (uint64_t)s;
+            borrow = (unsigned char)(s >> 64) & 1;
+        }
+        const uint64_t* src = (hi || !borrow) ? d : t;
+        std::copy(src, src + L, r);
+    }
+};
+
+// Calls f(p) for every prime p <= limit, segment by segment, so stage 1
+// bounds far past smallPrimes() cost no memory.
+template <class F>
+static void forEachPrime(unsigned long limit, F f)
+{
+    const std::vector<unsigned long>& base = smallPrimes();
+    const unsigned long kSegment = 1 << 18;
+    std::vector<bool> composite(kSegment);
+    for (unsigned long lo = 2; lo <= limit; lo += kSegment)
+    {
+        unsigned long hi = std::min(limit, lo + kSegment - 1);
+        std::fill(composite.begin(), composite.end(), false);
+        for (unsigned long p : base)
+        {
+            if (p * p > hi) break;
+            unsigned long j = std::max(p * p, (lo + p - 1) / p * p);
+            for (; j <= hi; j += p) composite[j - lo] = true;
+        }
+        for (unsigned long i = lo; i <= hi; i++)
+            if (!composite[i - lo]) f(i);
+    }
+}
+
+// x^-1 mod N, or false with the gcd in 'g' when x is not invertible.
+static bool invertMod(const mpz_class& x, const mpz_class& N, mpz_class& inv,
+                      mpz_class& g)
+{
+    if (mpz_invert(inv.get_mpz_t(), x.get_mpz_t(), N.get_mpz_t())) return true;
+    g = gcd(x, N);
+    return false;
+}
+
+enum EdwardsResult { EDWARDS_SKIPPED = -1, EDWARDS_NO_FACTOR = 0, EDWARDS_FACTOR = 1 };
+
+// Stage 1 on Suyama's curve for 'sigma' (the one GMP-ECM's ECM_PARAM_SUYAMA
+// builds, torsion Z/12) in twisted Edwards form a x^2 + y^2 = 1 + d x^2 y^2,
+// extended coordinates. The Montgomery curve B y^2 = x^3 + A x^2 + x is
+// taken with B = x0^3 + A x0^2 + x0 so that (x0, 1) is on it; this is the
+// curve GMP-ECM's x-only arithmetic works on, so the group and the stage 1
+// result agree with GMP-ECM's. Its a is not -1 (that needs a square root of
+// -a mod N), which costs one extra product per doubling and per addition.
+// With no factor, montA and montX are the Montgomery A and x of the stage 1
+// point, ready for GMP-ECM's stage 2 with sigma_is_A.
+template <unsigned L>
+static EdwardsResult edwardsStage1(const mpz_class& N, unsigned long sigma,
+                                   double B1, mpz_class& found, mpz_class& montA,
+                                   mpz_class& montX)
+{
+    typedef std::array<uint64_t, L> Fe;
+    struct Point { Fe X, Y, Z, T; };
+    const MontArith<L> F(N);
+
+    mpz_class s = sigma, u = s * s - 5, v = 4 * s, inv, g;
+    auto invOrFactor = [&](const mpz_class& x) {
+        if (invertMod(x, N, inv, g)) return true;
+        found = g;
+        return false;
+    };
+    if (!invOrFactor(v * v * v)) return g == N ? EDWARDS_SKIPPED : EDWARDS_FACTOR;
+    mpz_class x0 = u * u * u * inv % N;
+    if (!invOrFactor(4 * u * u * u * v)) return g == N ? EDWARDS_SKIPPED : EDWARDS_FACTOR;
+    mpz_class A = ((v - u) * (v - u) * (v - u) * (3 * u + v) * inv - 2) % N;
+    mpz_class B = ((x0 + A) * x0 + 1) * x0 % N;
+    if (!invOrFactor(B)) return g == N ? EDWARDS_SKIPPED : EDWARDS_FACTOR;
+    mpz_class ea = (A + 2) * inv % N, ed = (A - 2) * inv % N;
+    if (!invOrFactor(x0 + 1)) return g == N ? EDWARDS_SKIPPED : EDWARDS_FACTOR;
+    mpz_class ey = (x0 - 1) * inv % N;
+    for (mpz_class* z : {&ea, &ed, &ey})
+        if (*z < 0) *z += N;
+
+    Fe a, d;
+    F.toMont(a.data(), ea);
+    F.toMont(d.data(), ed);
+    Point P;
+    F.toMont(P.X.data(), x0);
+    F.toMont(P.Y.data(), ey);
+    F.toMont(P.Z.data(), 1);
+    F.mul(P.T.data(), P.X.data(), P.Y.data());
+
+    // dbl-2008-hwcd: 4S + 4M, T only when an addition follows
+    auto dbl = [&](Point& R, const Point& Q, bool needT) {
+        Fe sa, sb, sc, da, e, gg, f, h;
+        F.mul(sa.data(), Q.X.data(), Q.X.data());
+        F.mul(sb.data(), Q.Y.data(), Q.Y.data());
+        F.mul(sc.data(), Q.Z.data(), Q.Z.data());
+        F.add(sc.data(), sc.data(), sc.data());
+        F.mul(da.data(), a.data(), sa.data());
+        F.add(e.data(), Q.X.data(), Q.Y.data());
+        F.mul(e.data(), e.data(), e.data());
+        F.sub(e.data(), e.data(), sa.data());
+        F.sub(e.data(), e.data(), sb.data());
+        F.add(gg.data(), da.data(), sb.data());
+        F.sub(f.data(), gg.data(), sc.data());
+        F.sub(h.data(), da.data(), sb.data());
+        F.mul(R.X.data(), e.data(), f.data());
+        F.mul(R.Y.data(), gg.data(), h.data());
+        if (needT) F.mul(R.T.data(), e.data(), h.data());
+        F.mul(R.Z.data(), f.data(), gg.data());
+    };
+    // add-2008-hwcd: 10M, T only when this ends a chunk
+    auto add = [&](Point& R, const Point& Q1, const Point& Q2, bool needT) {
+        Fe sa, sb, sc, sd, e, t, f, gg, h;
+        F.mul(sa.data(), Q1.X.data(), Q2.X.data());
+        F.mul(sb.data(), Q1.Y.data(), Q2.Y.data());
+        F.mul(sc.data(), Q1.T.data(), Q2.T.data());
+        F.mul(sc.data(), sc.data(), d.data());
+        F.mul(sd.data(), Q1.Z.data(), Q2.Z.data());
+        F.add(e.data(), Q1.X.data(), Q1.Y.data());
+        F.add(t.data(), Q2.X.data(), Q2.Y.data());
+        F.mul(e.data(), e.data(), t.data());
+        F.sub(e.data(), e.data(), sa.data());
+        F.sub(e.data(), e.data(), sb.data());
+        F.sub(f.data(), sd.data(), sc.data());
+        F.add(gg.data(), sd.data(), sc.data());
+        F.mul(t.data(), a.data(), sa.data());
+        F.sub(h.data(), sb.data(), t.data());
+        F.mul(R.X.data(), e.data(), f.data());
+        F.mul(R.Y.data(), gg.data(), h.data());
+        if (needT) F.mul(R.T.data(), e.data(), h.data());
+        F.mul(R.Z.data(), f.data(), gg.data());
+    };
+
+    // P = [k] P for one chunk of the stage 1 multiplier, width-w NAF with
+    // the odd multiples P, 3P, ..., (2^(w-1) - 1)P precomputed.
+    std::vector<uint8_t> bits;
+    std::vector<int8_t> naf;
+    auto multiply = [&](const mpz_class& k) {
+        size_t nb = mpz_sizeinbase(k.get_mpz_t(), 2);
+        bits.assign(nb + kWindowBits + 1, 0);
+        for (size_t i = 0; i < nb; i++) bits[i] = mpz_tstbit(k.get_mpz_t(), i);
+        naf.assign(bits.size(), 0);
+        for (size_t i = 0; i < bits.size(); )
+        {
+            if (!bits[i]) { i++; continue; }
+            int w = 0;
+            for (unsigned j = 0; j < kWindowBits && i + j < bits.size(); j++)
+                w |= bits[i + j] << j;
+            if (w >= 1 << (kWindowBits - 1))
+            {
+                w -= 1 << kWindowBits;
+                size_t c = i + kWindowBits;     // carry the borrowed 2^w
+                while (bits[c]) bits[c++] = 0;
+                bits[c] = 1;
+            }
+            naf[i] = int8_t(w);
+            for (unsigned j = 0; j < kWindowBits && i + j < bits.size(); j++)
+                bits[i + j] = 0;
+            i += kWindowBits;
+        }
+
+        Point table[1 << (kWindowBits - 2)], twoP;
+        table[0] = P;
+        dbl(twoP, P, true);
+        for (unsigned i = 1; i < (1u << (kWindowBits - 2)); i++)
+            add(table[i], table[i - 1], twoP, true);
+
+        size_t top = naf.size();
+        while (top > 0 && naf[top - 1] == 0) top--;
+        Point R = table[(naf[top - 1] - 1) / 2];
+        for (size_t i = top - 1; i-- > 0; )
+        {
+            dbl(R, R, naf[i] != 0);
+            if (naf[i] == 0) continue;
+            Point Q = table[(std::abs(naf[i]) - 1) / 2];
+            if (naf[i] < 0)
+            {
+                F.neg(Q.X.data(), Q.X.data());
+                F.neg(Q.T.data(), Q.T.data());
+            }
+            add(R, R, Q, i == 0);
+        }
+        if (naf[0] == 0)
+        {
+            // ended on a doubling: (XZ : YZ : Z^2 : XY) restores T
+            F.mul(R.T.data(), R.X.data(), R.Y.data());
+            F.mul(R.X.data(), R.X.data(), R.Z.data());
+            F.mul(R.Y.data(), R.Y.data(), R.Z.data());
+            F.mul(R.Z.data(), R.Z.data(), R.Z.data());
+        }
+        P = R;
+    };
+
+    // multiplier: every prime power up to B1, fed in chunks
+    mpz_class chunk = 1;
+    bool stopped = false;
+    forEachPrime((unsigned long)B1, [&](unsigned long p) {
+        if (stopped) return;
+        unsigned long q = p;
+        while (q <= B1 / p) q *= p;
+        chunk *= q;
+        if (mpz_sizeinbase(chunk.get_mpz_t(), 2) >= kScalarChunkBits)
+        {
+            multiply(chunk);
+            chunk = 1;
+            stopped = stopAsap() != 0;
+        }
+    });
+    if (stopped) return EDWARDS_SKIPPED;
+    if (chunk > 1) multiply(chunk);
+
+    // Montgomery x = (Z + Y) / (Z - Y); Z - Y = 0 mod p is the neutral point
+    Fe num, den;
+    F.add(num.data(), P.Z.data(), P.Y.data());
+    F.sub(den.data(), P.Z.data(), P.Y.data());
+    mpz_class zmy = F.fromMont(den.data());
+    if (!invertMod(zmy, N, inv, g))
+    {
+        if (g == N) return EDWARDS_SKIPPED;
+        found = g;
+        return EDWARDS_FACTOR;
+    }
+    montX = F.fromMont(num.data()) * inv % N;
+    montA = A < 0 ? A + N : A;
+    return EDWARDS_NO_FACTOR;
+}
+
+// Dispatches on the limb count; EDWARDS_SKIPPED also when N is too wide.
+static EdwardsResult edwardsStage1(const mpz_class& N, unsigned long sigma,
+                                   double B1, mpz_class& found, mpz_class& montA,
+                                   mpz_class& montX)
+{
+    switch (mpz_size(N.get_mpz_t()))
+    {
+        case 1:
+        case 2: return edwardsStage1<2>(N, sigma, B1, found, montA, montX);
+        case 3: return edwardsStage1<3>(N, sigma, B1, found, montA, montX);
+        case 4: return edwardsStage1<4>(N, sigma, B1, found, montA, montX);
+        default: return EDWARDS_SKIPPED;
+    }
+}
+
+static const char* unitName(UnitKind kind)
+{
+    switch (kind)
+    {
+        case UNIT_RHO: return "rho";
+        case UNIT_PM1: return "P-1";
+        case UNIT_PP1: return "P+1";
+        case UNIT_SIQS: return "SIQS";
+        default:       return "ECM";
+    }
+}
+
+// -X: the in-house stage 1 and GMP-ECM's disagreed on one curve.
+static void reportMismatch(const Job& j, unsigned long sigma, double B1,
+                           const char* what)
+{
+    g_edwardsMismatches++;
+    std::lock_guard<std::mutex> lock(g_logMutex);
+    std::cerr << "stage 1 cross-check: job " << j.id << " sigma=" << sigma
+              << " B1=" << B1 << ": " << what << "\n";
+}
+
+// Runs one unit against its job's number. P-1 and P+1 go through ecm_factor
+// with the method switched, which gives them GMP-ECM's fast stage 2 for free.
+// For ECM curves the time spent in each stage is reported back.
+static int runUnit(const WorkUnit& u, mpz_class& found, double& stage1Sec,
+                   double& stage2Sec)
+{
+    const Job& j = *u.job;
+    stage1Sec = stage2Sec = 0;
+    if (u.kind == UNIT_RHO)
+        return pollardBrent(j.n, 1, kRhoIterations, found) ? 1 : 0;
+    if (u.kind == UNIT_SIQS)
+        return j.siqs->run(found);
+
+    mpz_t mpzN, factor;
+    mpz_init_set(mpzN, j.n.get_mpz_t());
     mpz_init(factor);
 
-    // For older GMP-ECM, 'params' is an array of 1
-    // e.g. ecm_params params; ecm_init(params);
-    // We'll let ecm_init do defaults (no B2 assignment).
-    ecm_params params;
-    ecm_init(params);
+    // Fresh params per unit: ecm_factor writes back x and B1done, which
+    // would otherwise make the next call resume the previous curve.
+    ecm_params params;
+    ecm_init(params);
+    params->stop_asap = stopAsap;
+
+    // 1 = found in stage 1, 2 = found in stage 2, <0 = error
+    int ret = ECM_NO_FACTOR_FOUND;
+    if (u.kind == UNIT_ECM)
+    {
+#ifdef ECM_PARAM_SUYAMA
+        params->param = ECM_PARAM_SUYAMA;
+#endif
+        unsigned long sigma = j.sigmaBase + u.curve;
+        mpz_set_ui(params->sigma, sigma);
+        double B1 = kLevels[u.level].B1;
+
+        // Stage 1 alone (B2 < B1 disables stage 2), then stage 2 resumed from
+        // the x it left behind with B1done = B1, the same path GMP-ECM's
+        // -resume takes. Same work as one call, but each stage gets timed.
+        // Below 2^256 stage 1 runs in-house on the same curve and hands GMP-ECM
+        // the Montgomery A and x instead.
+        mpz_t B2;
+        mpz_init_set(B2, params->B2);
+        mpz_set_ui(params->B2, 1);
+        auto t0 = std::chrono::steady_clock::now();
+        EdwardsResult er = EDWARDS_SKIPPED;
+        mpz_class edFound, montA, montX;
+        if (g_edwards && mpz_size(mpzN) <= kMaxMontLimbs)
+            er = edwardsStage1(j.n, sigma, B1, edFound, montA, montX);
+        if (er == EDWARDS_SKIPPED || g_edwardsCheck)
+            ret = ecm_factor(factor, mpzN, B1, params);
+        if (er == EDWARDS_FACTOR)
+        {
+            if (g_edwardsCheck && ret > 0 && mpz_class(factor) != edFound)
+                reportMismatch(j, sigma, B1, "factors differ");
+            mpz_set(factor, edFound.get_mpz_t());
+            ret = ECM_FACTOR_FOUND_STEP1;
+        }
+        else if (er == EDWARDS_NO_FACTOR)
+        {
+            if (g_edwardsCheck && (ret != ECM_NO_FACTOR_FOUND ||
+                                   mpz_class(params->x) != montX))
+                reportMismatch(j, sigma, B1, ret > 0 ? "GMP-ECM found a factor"
+                                                     : "stage 1 points differ");
+            if (!g_edwardsCheck || ret == ECM_NO_FACTOR_FOUND)
+            {
+                params->sigma_is_A = 1;
+                mpz_set(params->sigma, montA.get_mpz_t());
+                mpz_set(params->x, montX.get_mpz_t());
+                ret = ECM_NO_FACTOR_FOUND;
+            }
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        stage1Sec = std::chrono::duration<double>(t1 - t0).count();
+        if (ret == ECM_NO_FACTOR_FOUND && !stopAsap())
+        {
+            mpz_set(params->B2, B2);
+            params->B1done = B1;
+            ret = ecm_factor(factor, mpzN, B1, params);
+            stage2Sec = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - t1).count();
+        }
+        mpz_clear(B2);
+    }
+    else
+    {
+        params->method = u.kind == UNIT_PM1 ? ECM_PM1 : ECM_PP1;
+        ret = ecm_factor(factor, mpzN, u.kind == UNIT_PM1 ? kPm1B1 : kPp1B1,
+                         params);
+    }
+    if (ret > 0) found = mpz_class(factor);
+
+    ecm_clear(params);
+    mpz_clear(factor);
+    mpz_clear(mpzN);
+    return ret;
+}
+
+// Per-thread counters for the telemetry reporter. Only the owning worker
+// writes them; the reporter reads them without taking any lock.
+struct ThreadStats
+{
+    std::atomic<unsigned long> curves{0};
+    std::atomic<double> stage1Sec{0};
+    std::atomic<double> stage2Sec{0};
+    std::atomic<double> cheapSec{0};
+    std::atomic<double> siqsSec{0};
+};
+
+std::unique_ptr<ThreadStats[]> g_threadStats;
+unsigned g_numThreadStats = 0;
+
+// Curves run by remote workers. Their proxy threads book them under
+// g_remoteStatsMutex; the reporter reads them like a pool thread's.
+ThreadStats g_remoteStats;
+std::mutex g_remoteStatsMutex;
+
+static void addTo(std::atomic<double>& a, double v)
+{
+    a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+
+// Books one ECM unit's stage times; the curve counts unless the job had
+// split under it.
+static void bookCurve(ThreadStats& st, const WorkUnit& u, int ret,
+                      double stage1Sec, double stage2Sec)
+{
+    if (!(u.job->stop.load() && ret <= 0)) st.curves++;
+    addTo(st.stage1Sec, stage1Sec);
+    addTo(st.stage2Sec, stage2Sec);
+}
+
+// Pool thread: pulls units from the scheduler until it closes. Curve i of a
+// job always runs with sigma = job sigma base + i, so no two threads repeat
+// a curve and a run can be reproduced from the logged bases.
+void workerECM(unsigned threadID)
+{
+    WorkUnit u;
+    while (g_sched.next(u))
+    {
+        t_stop = &u.job->stop;
+        mpz_class found;
+        double stage1Sec, stage2Sec;
+        auto t0 = std::chrono::steady_clock::now();
+        int ret = runUnit(u, found, stage1Sec, stage2Sec);
+        t_stop = nullptr;
+
+        if (threadID < g_numThreadStats)
+        {
+            ThreadStats& st = g_threadStats[threadID];
+            if (u.kind == UNIT_ECM)
+            {
+                bookCurve(st, u, ret, stage1Sec, stage2Sec);
+            }
+            else
+            {
+                addTo(u.kind == UNIT_SIQS ? st.siqsSec : st.cheapSec,
+                      std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - t0).count());
+            }
+        }
+
+        if (g_verbose)
+        {
+            bool aborted = u.job->stop.load() && ret <= 0;
+            std::lock_guard<std::mutex> lock(g_logMutex);
+            std::cout << "  [thread " << threadID << "] job " << u.job->id << " ";
+            if (u.kind == UNIT_ECM)
+            {
+                const EcmLevel& L = kLevels[u.level];
+                std::cout << L.digits << "-digit level, B1=" << L.B1
+                          << " curve " << u.curve - u.job->levelStart[u.level]
+                          << " sigma=" << u.job->sigmaBase + u.curve;
+            }
+            else
+            {
+                std::cout << unitName(u.kind);
+            }
+            std::cout << (ret > 0 ? " -> factor " + found.get_str()
+                                  : aborted ? " (aborted)" : "")
+                      << "\n";
+        }
+
+        g_sched.complete(u, ret, found);
+        u.job.reset();
+    }
+}
+
+// Dickman's rho on a 1/1000 grid, integrated from rho'(u) = -rho(u-1)/u
+// with the trapezoidal rule; rho(u) = 1 for u <= 1.
+static double dickmanRho(double u)
+{
+    static const double kStep = 1e-3, kMaxU = 40;
+    static const std::vector<double> table = [] {
+        size_t n = size_t(kMaxU / kStep) + 1, one = size_t(1 / kStep);
+        std::vector<double> t(n, 1.0);
+        for (size_t i = one + 1; i < n; i++)
+        {
+            double u0 = (i - 1) * kStep, u1 = i * kStep;
+            t[i] = t[i - 1] - kStep / 2 * (t[i - 1 - one] / u0 + t[i - one] / u1);
+        }
+        return t;
+    }();
+    if (u <= 1) return 1;
+    if (u >= kMaxU) return 0;
+    double x = u / kStep;
+    size_t i = size_t(x);
+    double f = x - i;
+    return std::max(0.0, table[i] * (1 - f) + table[i + 1] * f);
+}
+
+// Probability that an integer of size e^lnN is B1-smooth apart from at most
+// one prime in (B1, B2]: rho(1/a) + integral over t in [a, b] of
+// rho((1 - t) / a) / t, with a = ln B1 / lnN and b = ln B2 / lnN.
+static double semiSmoothProb(double lnN, double B1, double B2)
+{
+    double a = std::log(B1) / lnN, b = std::min(1.0, std::log(B2) / lnN);
+    double p = dickmanRho(1 / a);
+    if (b <= a) return p;
+    const int steps = 200;    // Simpson, even
+    double h = (b - a) / steps, sum = 0;
+    for (int i = 0; i <= steps; i++)
+    {
+        double t = a + i * h;
+        double w = (i == 0 || i == steps) ? 1 : (i % 2 ? 4 : 2);
+        sum += w * dickmanRho((1 - t) / a) / t;
+    }
+    return std::min(1.0, p + sum * h / 3);
+}
+
+// Chance that one curve at level L finds a given prime of 'digits' digits.
+// Suyama curves have 12 | #E and behave like random group orders about
+// 23.4 times smaller (Montgomery), hence the shift in lnN.
+static double curveSuccessProb(unsigned digits, const EcmLevel& L)
+{
+    double lnP = (digits - 0.5) * std::log(10.0) - std::log(23.4);
+    return semiSmoothProb(lnP, L.B1, L.B2);
+}
+
+// Probability that a factor of 'digits' digits is still hiding after the
+// curves recorded in levelDone.
+static double missProbability(unsigned digits, const unsigned* levelDone,
+                              unsigned numLevels)
+{
+    double logMiss = 0;
+    for (unsigned l = 0; l < numLevels; l++)
+        logMiss += levelDone[l] * std::log1p(-curveSuccessProb(digits, kLevels[l]));
+    return std::exp(logMiss);
+}
+
+// Periodic progress report: curves/s per thread since the last report, the
+// stage-1 / stage-2 time split, curves per B1 level, and for each live job
+// the Dickman-rho estimate of having missed a factor of 20..65 digits. One
+// human-readable block goes to stderr; the same data as one JSON object per
+// line goes to 'json' when set.
+class Telemetry
+{
+public:
+    Telemetry(std::ostream* json, bool toStderr) : json_(json), stderr_(toStderr)
+    {
+        start_ = last_ = std::chrono::steady_clock::now();
+        lastCurves_.assign(g_numThreadStats, 0);
+    }
+
+    void report()
+    {
+        auto now = std::chrono::steady_clock::now();
+        double t = std::chrono::duration<double>(now - start_).count();
+        double dt = std::max(1e-9, std::chrono::duration<double>(now - last_).count());
+        last_ = now;
+
+        std::vector<double> rate(g_numThreadStats);
+        double totalRate = 0, s1 = 0, s2 = 0, cheap = 0, siqs = 0;
+        unsigned long curves = 0;
+        for (unsigned i = 0; i < g_numThreadStats; i++)
+        {
+            const ThreadStats& st = g_threadStats[i];
+            unsigned long c = st.curves.load();
+            rate[i] = (c - lastCurves_[i]) / dt;
+            lastCurves_[i] = c;
+            totalRate += rate[i];
+            curves += c;
+            s1 += st.stage1Sec.load();
+            s2 += st.stage2Sec.load();
+            cheap += st.cheapSec.load();
+            siqs += st.siqsSec.load();
+        }
+        unsigned long remoteCurves = g_remoteStats.curves.load();
+        double remoteRate = (remoteCurves - lastRemoteCurves_) / dt;
+        lastRemoteCurves_ = remoteCurves;
+        totalRate += remoteRate;
+        curves += remoteCurves;
+        s1 += g_remoteStats.stage1Sec.load();
+        s2 += g_remoteStats.stage2Sec.load();
+        std::vector<JobSnapshot> jobs = g_sched.snapshot();
+
+        if (stderr_)
+        {
+            std::ostringstream o;
+            o.setf(std::ios::fixed);
+            o.precision(2);
+            o << "[telemetry " << t << "s] " << curves << " curves, "
+              << totalRate << " curves/s (";
+            for (unsigned i = 0; i < g_numThreadStats; i++)
+                o << (i ? " " : "") << "t" << i << ":" << rate[i];
+            if (remoteCurves)
+                o << (g_numThreadStats ? " " : "") << "remote:" << remoteRate;
+            o << "), stage1 " << s1 << "s / stage2 " << s2 << "s, cheap "
+              << cheap << "s, SIQS " << siqs << "s\n  per level:";
+            for (unsigned l = 0; l < kNumLevels; l++)
+                if (g_levelCurves[l]) o << " " << kLevels[l].digits << "d:" << g_levelCurves[l];
+            o << "\n";
+            for (const JobSnapshot& j : jobs)
+            {
+                o << "  job " << j.id << " (input " << j.inputId << ", C" << j.digits
+                  << ") P(missed):";
+                for (unsigned l = 0; l < kNumLevels; l++)
+                    o << " " << kLevels[l].digits << "d="
+                      << missProbability(kLevels[l].digits, j.levelDone, j.numLevels);
+                o << "\n";
+            }
+            std::lock_guard<std::mutex> lock(g_logMutex);
+            std::cerr << o.str();
+        }
+
+        if (json_)
+        {
+            std::ostringstream o;
+            o << "{\"t\":" << t << ",\"curves\":" << curves
+              << ",\"curves_per_sec\":" << totalRate << ",\"threads\":[";
+            for (unsigned i = 0; i < g_numThreadStats; i++)
+            {
+                const ThreadStats& st = g_threadStats[i];
+                o << (i ? "," : "") << "{\"id\":" << i << ",\"curves\":"
+                  << st.curves.load() << ",\"curves_per_sec\":" << rate[i]
+                  << ",\"stage1_s\":" << st.stage1Sec.load() << ",\"stage2_s\":"
+                  << st.stage2Sec.load() << ",\"cheap_s\":" << st.cheapSec.load()
+                  << ",\"siqs_s\":" << st.siqsSec.load() << "}";
+            }
+            o << "],\"remote\":{\"curves\":" << remoteCurves
+              << ",\"curves_per_sec\":" << remoteRate << ",\"stage1_s\":"
+              << g_remoteStats.stage1Sec.load() << ",\"stage2_s\":"
+              << g_remoteStats.stage2Sec.load() << "}";
+            o << ",\"stage1_s\":" << s1 << ",\"stage2_s\":" << s2
+              << ",\"siqs_s\":" << siqs
+              << ",\"levels\":[";
+            for (unsigned l = 0; l < kNumLevels; l++)
+                o << (l ? "," : "") << "{\"digits\":" << kLevels[l].digits
+                  << ",\"B1\":" << kLevels[l].B1 << ",\"curves\":"
+                  << g_levelCurves[l].load() << "}";
+            o << "],\"jobs\":[";
+            for (size_t k = 0; k < jobs.size(); k++)
+            {
+                const JobSnapshot& j = jobs[k];
+                o << (k ? "," : "") << "{\"job\":" << j.id << ",\"input\":"
+                  << j.inputId << ",\"digits\":" << j.digits << ",\"level_curves\":[";
+                for (unsigned l = 0; l < j.numLevels; l++)
+                    o << (l ? "," : "") << j.levelDone[l];
+                o << "],\"p_missed\":{";
+                for (unsigned l = 0; l < kNumLevels; l++)
+                    o << (l ? "," : "") << "\"" << kLevels[l].digits << "\":"
+                      << missProbability(kLevels[l].digits, j.levelDone, j.numLevels);
+                o << "}}";
+            }
+            o << "]}\n";
+            std::lock_guard<std::mutex> lock(g_logMutex);
+            *json_ << o.str() << std::flush;
+        }
+    }
+
+private:
+    std::ostream* json_;
+    bool stderr_;
+    std::chrono::steady_clock::time_point start_, last_;
+    std::vector<unsigned long> lastCurves_;
+    unsigned long lastRemoteCurves_ = 0;
+};
+
+static void telemetryLoop(Telemetry& tel, unsigned interval,
+                          const std::atomic_bool& done)
+{
+    auto last = std::chrono::steady_clock::now();
+    while (!done.load())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        auto now = std::chrono::steady_clock::now();
+        if (now - last >= std::chrono::seconds(interval))
+        {
+            tel.report();
+            last = now;
+        }
+    }
+}
+
+// "p1^e1 * p2 * ..." for the sorted primes, then any unsplit composites.
+static std::string formatFactorization(Input& in)
+{
+    std::sort(in.primes.begin(), in.primes.end());
+    std::string s;
+    for (size_t i = 0; i < in.primes.size();)
+    {
+        size_t k = i;
+        while (k < in.primes.size() && in.primes[k] == in.primes[i]) k++;
+        if (!s.empty()) s += " * ";
+        s += in.primes[i].get_str();
+        if (k - i > 1) s += "^" + std::to_string(k - i);
+        i = k;
+    }
+    for (const mpz_class& c : in.composites)
+    {
+        if (!s.empty()) s += " * ";
+        s += "C" + std::to_string(c.get_str().size()) + "(" + c.get_str() + ")";
+    }
+    return s.empty() ? "1" : s;
+}
+
+static void startWorkers(std::vector<std::thread>& threads, unsigned numThreads)
+{
+    threads.reserve(numThreads);
+    for (unsigned t = 0; t < numThreads; t++)
+    {
+        threads.emplace_back(workerECM, t);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Coordinator and remote workers. A coordinator (-L) runs the scheduler and
+// checkpoint as usual and also accepts worker processes (-W) on a Unix
+// socket, or on TCP when the address is host:port. The protocol is one line
+// per message:
+//
+//   worker -> coordinator   HELLO <slots>
+//                           DONE <tag> <ret> <factor|0> <stage1 s> <stage2 s>
+//                           PING
+//   coordinator -> worker   UNIT <tag> <job> <kind> <level> <sigma> <n>
+//                           STOP <job>
+//                           BYE
+//
+// Each connection gets a proxy that keeps up to <slots> units out. A worker
+// that hangs up or stays silent past the heartbeat timeout has its units
+// handed back to the scheduler for someone else to run.
+// ---------------------------------------------------------------------------
+
+static const int kHeartbeatSec = 2;
+static const int kHeartbeatTimeoutSec = 10;
+
+// Line-oriented wrapper around a connected socket; sends may come from
+// several threads.
+class LineConn
+{
+public:
+    explicit LineConn(int fd) : fd_(fd) {}
+    ~LineConn() { ::close(fd_); }
+
+    bool send(const std::string& line)
+    {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        std::string msg = line + "\n";
+        for (size_t off = 0; off < msg.size(); )
+        {
+            ssize_t w = ::send(fd_, msg.data() + off, msg.size() - off, MSG_NOSIGNAL);
+            if (w <= 0) return false;
+            off += w;
+        }
+        return true;
+    }
+
+    // 1 = got a line, 0 = nothing within timeoutMs, -1 = closed or error.
+    int readLine(std::string& line, int timeoutMs)
+    {
+        for (;;)
+        {
+            size_t nl = buf_.find('\n');
+            if (nl != std::string::npos)
+            {
+                line = buf_.substr(0, nl);
+                buf_.erase(0, nl + 1);
+                return 1;
+            }
+            pollfd p = {fd_, POLLIN, 0};
+            int r = ::poll(&p, 1, timeoutMs);
+            if (r == 0) return 0;
+            if (r < 0 && errno == EINTR) continue;
+            char tmp[4096];
+            ssize_t got = r > 0 ? ::recv(fd_, tmp, sizeof(tmp), 0) : -1;
+            if (got <= 0) return -1;
+            buf_.append(tmp, got);
+        }
+    }
+
+    void shutdown() { ::shutdown(fd_, SHUT_RDWR); }
+
+private:
+    int fd_;
+    std::string buf_;
+    std::mutex writeMutex_;
+};
+
+// "host:port" is TCP (numeric IPv4 host), anything else a Unix socket path.
+static bool parseTcpAddress(const std::string& spec, sockaddr_in& addr)
+{
+    size_t colon = spec.rfind(':');
+    if (colon == std::string::npos || colon + 1 == spec.size() ||
+        spec.find_first_not_of("0123456789", colon + 1) != std::string::npos)
+        return false;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(std::atoi(spec.c_str() + colon + 1));
+    std::string host = colon ? spec.substr(0, colon) : "127.0.0.1";
+    return inet_pton(AF_INET, host.c_str(), &addr.sin_addr) == 1;
+}
+
+static int openSocket(const std::string& spec, bool listening)
+{
+    sockaddr_in tcp;
+    sockaddr_un unixAddr;
+    sockaddr* addr;
+    socklen_t len;
+    int fd;
+    if (parseTcpAddress(spec, tcp))
+    {
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        if (fd >= 0 && listening)
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        addr = (sockaddr*)&tcp;
+        len = sizeof(tcp);
+    }
+    else
+    {
+        if (spec.size() >= sizeof(unixAddr.sun_path)) return -1;
+        std::memset(&unixAddr, 0, sizeof(unixAddr));
+        unixAddr.sun_family = AF_UNIX;
+        std::strcpy(unixAddr.sun_path, spec.c_str());
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listening) ::unlink(spec.c_str());
+        addr = (sockaddr*)&unixAddr;
+        len = sizeof(unixAddr);
+    }
+    if (fd < 0) return -1;
+    bool ok = listening ? ::bind(fd, addr, len) == 0 && ::listen(fd, 64) == 0
+                        : ::connect(fd, addr, len) == 0;
+    if (!ok)
+    {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Coordinator side of one worker connection: a feeder thread keeps the
+// worker's slots filled from the scheduler, the calling thread reads its
+// replies and watches the heartbeat. The state is shared with the feeder,
+// which may still sit in next() when the worker goes away.
+struct RemoteProxy
+{
+    explicit RemoteProxy(int fd) : conn(fd) {}
+    LineConn conn;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::unordered_map<unsigned, WorkUnit> outstanding;   // by tag
+    std::set<unsigned> stopSent;                          // job ids
+    unsigned slots = 0;
+    unsigned nextTag = 0;
+    bool dead = false;
+};
+
+static void feedRemoteWorker(std::shared_ptr<RemoteProxy> px)
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(px->mutex);
+            px->cv.wait(lock, [&] { return px->dead || px->outstanding.size() < px->slots; });
+            if (px->dead) return;
+        }
+        WorkUnit u;
+        if (!g_sched.next(u, false))
+        {
+            px->conn.send("BYE");
+            return;
+        }
+        std::unique_lock<std::mutex> lock(px->mutex);
+        if (px->dead)
+        {
+            lock.unlock();
+            g_sched.requeue(u);
+            return;
+        }
+        unsigned tag = px->nextTag++;
+        px->outstanding[tag] = u;
+        std::ostringstream o;
+        o << "UNIT " << tag << " " << u.job->id << " " << u.kind << " "
+          << (u.kind == UNIT_ECM ? u.level : 0) << " "
+          << (u.kind == UNIT_ECM ? u.job->sigmaBase + u.curve : 0) << " "
+          << u.job->n.get_str();
+        lock.unlock();
+        px->conn.send(o.str());
+    }
+}
+
+// Books one DONE reply. False when the line does not parse or claims a
+// factor that does not divide the unit's number; the caller then drops the
+// worker, and the unit is requeued with everything else it held.
+static bool bookRemoteDone(RemoteProxy& px, const std::string& line)
+{
+    unsigned tag;
+    int ret;
+    char factor[4096];
+    double s1, s2;
+    mpz_class found;
+    if (std::sscanf(line.c_str(), "DONE %u %d %4095s %lf %lf", &tag, &ret,
+                    factor, &s1, &s2) != 5 ||
+        mpz_set_str(found.get_mpz_t(), factor, 10) != 0)
+        return false;
+    WorkUnit u;
+    {
+        std::lock_guard<std::mutex> lock(px.mutex);
+        auto it = px.outstanding.find(tag);
+        if (it == px.outstanding.end()) return true;   // already given up on
+        if (ret > 0 && (found <= 0 ||
+                        !mpz_divisible_p(it->second.job->n.get_mpz_t(), found.get_mpz_t())))
+            return false;
+        u = it->second;
+        px.outstanding.erase(it);
+    }
+    px.cv.notify_all();
+    if (u.kind == UNIT_ECM)
+    {
+        std::lock_guard<std::mutex> lock(g_remoteStatsMutex);
+        bookCurve(g_remoteStats, u, ret, s1, s2);
+    }
+    g_sched.complete(u, ret, found);
+    return true;
+}
+
+static void serveRemoteWorker(int fd)
+{
+    auto px = std::make_shared<RemoteProxy>(fd);
+    std::string line;
+    if (px->conn.readLine(line, kHeartbeatTimeoutSec * 1000) != 1 ||
+        std::sscanf(line.c_str(), "HELLO %u", &px->slots) != 1 || px->slots == 0)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(g_logMutex);
+        std::cerr << "remote worker connected (" << px->slots << " slots)\n";
+    }
+    // a feeder blocked in next() returns with a unit (requeued at once) or
+    // when the queue closes, so it is left to finish on its own
+    std::thread(feedRemoteWorker, px).detach();
 
-    // Example: do 'totalCurvesPerThread' ECM attempts
-    for (unsigned i = 0; i < totalCurvesPerThread && !g_foundFactor.load(); i++)
+    auto lastHeard = std::chrono::steady_clock::now();
+    for (;;)
     {
-        // B1 = 1e6, you can adjust if needed
-        int ret = ecm_factor(factor, mpzN, 1e9, params);
-        if (ret == 1)
+        int r = px->conn.readLine(line, 500);
+        auto now = std::chrono::steady_clock::now();
+        if (r < 0 || now - lastHeard > std::chrono::seconds(kHeartbeatTimeoutSec))
+            break;
+        if (r == 1)
+        {
+            lastHeard = now;
+            if (line.compare(0, 5, "DONE ") == 0 && !bookRemoteDone(*px, line))
+            {
+                std::lock_guard<std::mutex> lock(g_logMutex);
+                std::cerr << "remote worker sent a bad reply, dropping it: "
+                          << line.substr(0, 80) << "\n";
+                break;
+            }
+        }
+        // tell the worker to drop units on jobs that have split meanwhile
+        std::vector<unsigned> stops;
         {
-            mpz_class candidate(factor);
-            if (candidate > 1 && candidate < N) 
+            std::lock_guard<std::mutex> lock(px->mutex);
+            for (const auto& o : px->outstanding)
+                if (o.second.job->stop.load() && px->stopSent.insert(o.second.job->id).second)
+                    stops.push_back(o.second.job->id);
+        }
+        for (unsigned id : stops) px->conn.send("STOP " + std::to_string(id));
+    }
+
+    std::vector<WorkUnit> lost;
+    {
+        std::lock_guard<std::mutex> lock(px->mutex);
+        px->dead = true;
+        for (const auto& o : px->outstanding) lost.push_back(o.second);
+        px->outstanding.clear();
+    }
+    px->cv.notify_all();
+    px->conn.shutdown();
+    for (const WorkUnit& u : lost) g_sched.requeue(u);
+    if (!lost.empty())
+    {
+        std::lock_guard<std::mutex> lock(g_logMutex);
+        std::cerr << "remote worker lost; " << lost.size() << " unit(s) requeued\n";
+    }
+}
+
+std::atomic_bool g_acceptorStop{false};
+
+// Accepts workers until g_acceptorStop is set.
+static void acceptRemoteWorkers(int listenFd)
+{
+    std::vector<std::thread> proxies;
+    while (!g_acceptorStop.load())
+    {
+        pollfd p = {listenFd, POLLIN, 0};
+        if (::poll(&p, 1, 250) <= 0) continue;
+        int fd = ::accept(listenFd, nullptr, nullptr);
+        if (fd >= 0) proxies.emplace_back(serveRemoteWorker, fd);
+    }
+    ::close(listenFd);
+    for (auto& th : proxies) th.join();
+}
+
+// -W: connects to a coordinator and runs whatever it hands out on
+// numThreads threads until it says BYE or goes away.
+static int runRemoteWorker(const char* spec, unsigned numThreads)
+{
+    int fd = openSocket(spec, false);
+    if (fd < 0)
+    {
+        std::cerr << "cannot connect to " << spec << "\n";
+        return 1;
+    }
+    LineConn conn(fd);
+    conn.send("HELLO " + std::to_string(numThreads));
+
+    // Each unit gets its own Job copy (runUnit reads sigma from it); the
+    // per-job entry in 'jobs' carries the stop flag all of them poll.
+    struct Task { unsigned tag; WorkUnit u; JobPtr shared; };
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::list<Task> queue;
+    std::unordered_map<unsigned, JobPtr> jobs;
+    bool closing = false;
+    unsigned long units = 0;
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < numThreads; t++)
+    {
+        threads.emplace_back([&] {
+            for (;;)
             {
-                bool expected = false;
-                if (g_foundFactor.compare_exchange_strong(expected, true))
+                Task task;
                 {
-                    std::lock_guard<std::mutex> lock(g_factorMutex);
-                    g_factor = candidate;
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [&] { return closing || !queue.empty(); });
+                    if (closing) return;
+                    task = queue.front();
+                    queue.pop_front();
                 }
+                t_stop = &task.shared->stop;
+                mpz_class found;
+                double s1, s2;
+                int ret = runUnit(task.u, found, s1, s2);
+                t_stop = nullptr;
+                std::ostringstream o;
+                o << "DONE " << task.tag << " " << ret << " "
+                  << (ret > 0 ? found.get_str() : "0") << " " << s1 << " " << s2;
+                conn.send(o.str());
+                std::lock_guard<std::mutex> lock(mutex);
+                units++;
+            }
+        });
+    }
+    std::thread heartbeat([&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!cv.wait_for(lock, std::chrono::seconds(kHeartbeatSec),
+                            [&] { return closing; }))
+        {
+            lock.unlock();
+            conn.send("PING");
+            lock.lock();
+        }
+    });
+
+    std::string line;
+    for (;;)
+    {
+        int r = conn.readLine(line, 1000);
+        if (r < 0 || line == "BYE") break;
+        if (r == 0) continue;
+        std::istringstream in(line);
+        std::string cmd;
+        in >> cmd;
+        if (cmd == "UNIT")
+        {
+            Task task;
+            unsigned jobId, kind;
+            unsigned long sigma;
+            std::string n;
+            in >> task.tag >> jobId >> kind >> task.u.level >> sigma >> n;
+            if (!in || kind > UNIT_ECM || task.u.level >= kNumLevels) continue;
+            std::lock_guard<std::mutex> lock(mutex);
+            JobPtr& j = jobs[jobId];
+            if (!j)
+            {
+                j = std::make_shared<Job>();
+                j->id = jobId;
+                j->n.set_str(n, 10);
+            }
+            // runUnit uses sigma = job sigma base + curve
+            task.shared = j;
+            task.u.job = std::make_shared<Job>();
+            task.u.job->id = jobId;
+            task.u.job->n = j->n;
+            task.u.job->sigmaBase = sigma;
+            task.u.kind = UnitKind(kind);
+            task.u.curve = 0;
+            queue.push_back(task);
+            cv.notify_all();    // the heartbeat thread waits on cv as well
+        }
+        else if (cmd == "STOP")
+        {
+            unsigned jobId;
+            in >> jobId;
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.remove_if([&](const Task& t) {
+                if (t.u.job->id != jobId) return false;
+                // still answered, so the coordinator can book it as aborted
+                conn.send("DONE " + std::to_string(t.tag) + " 0 0 0 0");
+                return true;
+            });
+            auto it = jobs.find(jobId);
+            if (it != jobs.end())
+            {
+                it->second->stop = true;
+                jobs.erase(it);
             }
-            break;
         }
     }
 
-    mpz_clear(factor);
-    mpz_clear(mpzN);
-    ecm_clear(params);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+        for (auto& j : jobs) j.second->stop = true;
+    }
+    cv.notify_all();
+    for (auto& th : threads) th.join();
+    heartbeat.join();
+    std::cerr << "worker done: " << units << " units\n";
+    return 0;
 }
 
-int main()
+// -L: listens on spec and accepts workers on a background thread.
+static bool startCoordinator(const char* spec, std::thread& acceptor)
 {
-    mpz_class N(N_str);
-    std::cout << "Factoring N = 10^63 + 19 with older GMP-ECM.\n";
-    std::cout << "N = " << N.get_str() << "\n\n";
+    int fd = openSocket(spec, true);
+    if (fd < 0)
+    {
+        std::cerr << "cannot listen on " << spec << "\n";
+        return false;
+    }
+    acceptor = std::thread(acceptRemoteWorkers, fd);
+    return true;
+}
 
-    auto start = std::chrono::steady_clock::now();
+// Runs f(0) .. f(count - 1) on up to 'threads' threads.
+template <class F>
+static void parallelFor(size_t count, unsigned threads, F f)
+{
+    threads = std::max(1u, std::min<unsigned>(threads, count));
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++)
+        pool.emplace_back([&, t] {
+            for (size_t i = t; i < count; i += threads) f(i);
+        });
+    for (size_t i = 0; i < count; i += threads) f(i);
+    for (auto& th : pool) th.join();
+}
 
-    unsigned numThreads = std::thread::hardware_concurrency();
-    if (numThreads == 0) numThreads = 4;
-    std::cout << "Using " << numThreads << " threads.\n";
+// Bernstein's batch GCD: g[i] = gcd(n[i], product of all the others), from
+// a product tree and a remainder tree (P mod n[i]^2, then divided by n[i]).
+// Each tree level is split across the threads. Where g[i] == n[i] (every
+// prime of n[i] occurs elsewhere) the pairwise gcds recover proper pieces.
+static std::vector<mpz_class> batchGcd(const std::vector<mpz_class>& n,
+                                       unsigned threads)
+{
+    std::vector<std::vector<mpz_class>> tree(1, n);
+    while (tree.back().size() > 1)
+    {
+        const std::vector<mpz_class>& below = tree.back();
+        std::vector<mpz_class> level((below.size() + 1) / 2);
+        parallelFor(level.size(), threads, [&](size_t i) {
+            level[i] = 2 * i + 1 < below.size() ? below[2 * i] * below[2 * i + 1]
+                                                : below[2 * i];
+        });
+        tree.push_back(std::move(level));
+    }
+
+    std::vector<mpz_class> rem = tree.back();
+    for (size_t l = tree.size() - 1; l-- > 0; )
+    {
+        const std::vector<mpz_class>& level = tree[l];
+        std::vector<mpz_class> next(level.size());
+        parallelFor(level.size(), threads, [&](size_t i) {
+            mpz_class sq = level[i] * level[i];
+            next[i] = rem[i / 2] % sq;
+        });
+        rem.swap(next);
+    }
+
+    std::vector<mpz_class> g(n.size());
+    parallelFor(n.size(), threads, [&](size_t i) {
+        g[i] = gcd(rem[i] / n[i], n[i]);
+        if (g[i] != n[i] || n[i] == 1) return;
+        for (size_t j = 0; j < n.size(); j++)
+        {
+            mpz_class h = gcd(n[i], n[j]);
+            if (j != i && h > 1 && h < n[i])
+            {
+                g[i] = h;
+                return;
+            }
+        }
+    });
+    return g;
+}
+
+volatile std::sig_atomic_t g_terminate = 0;
+
+static void onTerminate(int)
+{
+    g_terminate = 1;
+}
+
+// Writes the scheduler state through a temp file, fsync and rename, so a
+// kill in the middle of a write leaves the previous checkpoint intact.
+static bool writeCheckpoint(const std::string& path)
+{
+    std::ostringstream state;
+    g_sched.checkpoint(state);
+    const std::string& text = state.str();
+    std::string tmp = path + ".tmp";
+    FILE* f = std::fopen(tmp.c_str(), "w");
+    if (!f) return false;
+    bool ok = std::fwrite(text.data(), 1, text.size(), f) == text.size() &&
+              std::fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = std::fclose(f) == 0 && ok;
+    return ok && std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+// Rewrites the checkpoint every 'interval' seconds until 'done' is set.
+// SIGINT/SIGTERM (a preemption notice, say) get one last write, then exit;
+// curves in flight at that moment are lost and rerun on resume.
+static void checkpointLoop(const std::string& path, unsigned interval,
+                           const std::atomic_bool& done)
+{
+    auto last = std::chrono::steady_clock::now();
+    while (!done.load())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (g_terminate)
+        {
+            bool ok = writeCheckpoint(path);
+            std::cerr << (ok ? "checkpoint written to " : "checkpoint FAILED: ")
+                      << path << ", exiting\n";
+            std::_Exit(ok ? 2 : 1);
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now - last >= std::chrono::seconds(interval))
+        {
+            if (!writeCheckpoint(path))
+                std::cerr << "warning: cannot write checkpoint " << path << "\n";
+            last = now;
+        }
+    }
+}
+
+// Loads 'path' into the scheduler if it exists. A missing file is a fresh
+// start; an unreadable one is reported and ignored.
+static void resumeCheckpoint(const std::string& path, std::vector<Input*>& restored,
+                             std::vector<unsigned long>& finishedIds)
+{
+    std::ifstream f(path);
+    if (!f) return;
+    if (!g_sched.restore(f, restored, finishedIds))
+    {
+        std::cerr << "warning: ignoring unreadable checkpoint " << path << "\n";
+        return;
+    }
+    std::cerr << "Resumed from " << path << ": " << restored.size()
+              << " open, " << finishedIds.size() << " finished input(s).\n";
+}
 
-    // Suppose we want 100 total curves:
-    unsigned totalCurves = 100;
-    unsigned curvesPerThread = totalCurves / numThreads;
-    if (curvesPerThread < 1) curvesPerThread = 1;
+// Batch mode: one number per line (blank lines and '#' comments skipped),
+// all sharing one worker pool. Each result is printed the moment its number
+// is fully settled, tagged with the number's 1-based position in the input.
+static int runBatch(const char* path, unsigned numThreads,
+                    const std::vector<Input*>& restored,
+                    const std::vector<unsigned long>& finishedIds,
+                    bool sharedFactors)
+{
+    std::ifstream file;
+    std::istream* src = &std::cin;
+    if (std::strcmp(path, "-"))
+    {
+        file.open(path);
+        if (!file)
+        {
+            std::cerr << "cannot open " << path << "\n";
+            return 1;
+        }
+        src = &file;
+    }
 
+    auto start = std::chrono::steady_clock::now();
     std::vector<std::thread> threads;
-    threads.reserve(numThreads);
-    for (unsigned t = 0; t < numThreads; t++)
+    startWorkers(threads, numThreads);
+
+    // After a resume, lines already finished are skipped and lines still
+    // open continue from their restored state instead of starting over.
+    std::vector<unsigned long> skip(finishedIds);
+    for (Input* in : restored) skip.push_back(in->id);
+    std::sort(skip.begin(), skip.end());
+
+    std::atomic<unsigned> submitted(restored.size());
+    std::thread reader([&] {
+        // With -g every line is read before anything is queued, so batch GCD
+        // can split off shared primes before the per-number work starts.
+        std::vector<Input*> held;
+        std::string line;
+        unsigned id = 0;
+        while (std::getline(*src, line))
+        {
+            size_t b = line.find_first_not_of(" \t\r");
+            if (b == std::string::npos || line[b] == '#') continue;
+            size_t e = line.find_last_not_of(" \t\r");
+            std::string text = line.substr(b, e - b + 1);
+            id++;
+            if (std::binary_search(skip.begin(), skip.end(), id)) continue;
+
+            Input* in = new Input;
+            in->id = id;
+            if (in->n.set_str(text, 10) != 0 || in->n < 1)
+            {
+                std::lock_guard<std::mutex> lock(g_logMutex);
+                std::cout << id << " " << text << " = error: not a positive integer"
+                          << std::endl;
+                delete in;
+                continue;
+            }
+            submitted++;
+            if (sharedFactors)
+                held.push_back(in);
+            else
+                g_sched.submit(in);
+        }
+        if (!held.empty())
+        {
+            std::vector<mpz_class> n;
+            for (Input* in : held) n.push_back(in->n);
+            auto t0 = std::chrono::steady_clock::now();
+            std::vector<mpz_class> g = batchGcd(n, numThreads);
+            unsigned sharing = 0;
+            for (size_t i = 0; i < held.size(); i++)
+            {
+                if (g[i] == 1) continue;
+                sharing++;
+                std::lock_guard<std::mutex> lock(g_logMutex);
+                std::cout << "# " << held[i]->id << " shares " << g[i].get_str()
+                          << std::endl;
+            }
+            std::cerr << "batch GCD: " << sharing << " of " << held.size()
+                      << " numbers share a factor ("
+                      << std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - t0).count()
+                      << " s)\n";
+            for (size_t i = 0; i < held.size(); i++)
+            {
+                if (g[i] == 1)
+                    g_sched.submit(held[i]);
+                else
+                    g_sched.submit(held[i], std::vector<mpz_class>(1, g[i]));
+            }
+        }
+        g_sched.close();
+    });
+
+    std::vector<Input*> done;
+    unsigned finished = 0;
+    while (g_sched.waitFinished(done))
     {
-        threads.emplace_back(workerECM, std::cref(N), t, curvesPerThread);
+        for (Input* in : done)
+        {
+            double sec = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - in->start).count();
+            std::lock_guard<std::mutex> lock(g_logMutex);
+            std::cout << in->id << " " << in->n.get_str() << " = "
+                      << formatFactorization(*in) << "  (" << in->curves
+                      << " curves, " << sec << " s)" << std::endl;
+            delete in;
+            finished++;
+        }
     }
 
+    reader.join();
     for (auto &th : threads) {
         if (th.joinable()) th.join();
     }
 
-    auto end = std::chrono::steady_clock::now();
-    double elapsedSec = std::chrono::duration<double>(end - start).count();
+    double elapsedSec = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cerr << finished << " of " << submitted.load() << " numbers in "
+              << elapsedSec << " seconds.\n";
+    return 0;
+}
+
+// Benchmark corpus: semiprimes of a given size whose smaller factor has a
+// known number of digits. The balanced rows exercise SIQS (and ECM below
+// 30 digits), the 60-digit rows ECM at several factor sizes.
+struct BenchRow
+{
+    unsigned digits;
+    unsigned factorDigits;
+};
+
+static const BenchRow kBenchRows[] = {
+    {20, 10}, {30, 15}, {40, 20}, {50, 25}, {60, 30},
+    {60, 15}, {60, 20}, {60, 25},
+};
+static const unsigned kBenchDefaultPerRow = 10;   // -R
+static const unsigned long kBenchSeed = 20240601;
+static const unsigned long kBenchSigmaBase = 1000000;
 
-    mpz_class f1;
+// The p-th percentile (nearest rank) of v.
+static double percentile(std::vector<double> v, double p)
+{
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    size_t rank = (size_t)std::ceil(p / 100 * v.size());
+    return v[std::min(v.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+// -B: factors the seeded corpus (perRow numbers per row) one number at a
+// time with 1, 2, 4, ... pool threads and finally maxThreads, and writes
+// one JSON document with the time-to-factor median and p90 per row and the
+// stage breakdown per run.
+// The sigma base is fixed unless -s is given, so runs are repeatable.
+static int runBench(const char* jsonPath, unsigned maxThreads, unsigned perRow)
+{
+    gmp_randclass rng(gmp_randinit_mt);
+    rng.seed(kBenchSeed);
+    const unsigned rows = sizeof(kBenchRows) / sizeof(kBenchRows[0]);
+    std::vector<mpz_class> corpus, smallFactor;
+    for (const BenchRow& r : kBenchRows)
     {
-        std::lock_guard<std::mutex> lock(g_factorMutex);
-        f1 = g_factor;
+        for (unsigned i = 0; i < perRow; i++)
+        {
+            // p of factorDigits digits, q so that p q has the row's digits
+            mpz_class lo, span, p, q;
+            mpz_ui_pow_ui(lo.get_mpz_t(), 10, r.factorDigits - 1);
+            span = 9 * lo;
+            mpz_nextprime(p.get_mpz_t(), mpz_class(lo + rng.get_z_range(span)).get_mpz_t());
+            mpz_class nLo;
+            mpz_ui_pow_ui(nLo.get_mpz_t(), 10, r.digits - 1);
+            mpz_class qLo = nLo / p + 1, qSpan = 9 * nLo / p;
+            do
+                mpz_nextprime(q.get_mpz_t(),
+                              mpz_class(qLo + rng.get_z_range(qSpan)).get_mpz_t());
+            while (mpz_class(p * q).get_str().size() != r.digits);
+            corpus.push_back(p * q);
+            smallFactor.push_back(std::min(p, q));
+        }
     }
 
-    if (f1 == 0)
+    std::ostringstream json;
+    json << "{\"seed\":" << kBenchSeed << ",\"sigma_base\":" << g_sched.sigmaBase
+         << ",\"edwards\":" << (g_edwards ? "true" : "false")
+         << ",\"siqs_max_digits\":" << g_sched.maxSiqsDigits
+         << ",\"per_row\":" << perRow << ",\"runs\":[";
+    for (unsigned threads = 1;; threads = std::min(2 * threads, maxThreads))
     {
-        std::cout << "\nNo factor found after " << totalCurves 
-                  << " total curves.\nTime elapsed: " 
-                  << elapsedSec << " seconds.\n";
-        return 0;
+        for (unsigned i = 0; i < g_numThreadStats; i++)
+        {
+            ThreadStats& st = g_threadStats[i];
+            st.curves = 0;
+            st.stage1Sec = st.stage2Sec = st.cheapSec = st.siqsSec = 0;
+        }
+        g_sched.reopen();
+        std::vector<std::thread> pool;
+        startWorkers(pool, threads);
+
+        std::vector<double> sec(corpus.size());
+        std::vector<unsigned> curves(corpus.size());
+        std::vector<bool> ok(corpus.size());
+        auto start = std::chrono::steady_clock::now();
+        for (size_t k = 0; k < corpus.size(); k++)
+        {
+            // handed back only once every unit on it is booked, as in -b
+            Input* in = new Input;
+            in->id = k + 1;
+            in->n = corpus[k];
+            g_sched.submit(in);
+            std::vector<Input*> done;
+            while (done.empty()) g_sched.waitFinished(done);
+            sec[k] = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - in->start).count();
+            curves[k] = in->curves;
+            ok[k] = std::find(in->primes.begin(), in->primes.end(), smallFactor[k]) !=
+                    in->primes.end();
+            std::cerr << "bench t=" << threads << " #" << k + 1 << " C"
+                      << in->n.get_str().size() << ": " << sec[k] << " s, "
+                      << curves[k] << " curves" << (ok[k] ? "" : " (NOT factored)")
+                      << "\n";
+            delete in;
+        }
+        double wall = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+        g_sched.close();
+        for (auto& th : pool) th.join();
+
+        double s1 = 0, s2 = 0, cheap = 0, siqs = 0;
+        unsigned long totalCurves = 0;
+        for (unsigned i = 0; i < threads; i++)
+        {
+            const ThreadStats& st = g_threadStats[i];
+            totalCurves += st.curves.load();
+            s1 += st.stage1Sec.load();
+            s2 += st.stage2Sec.load();
+            cheap += st.cheapSec.load();
+            siqs += st.siqsSec.load();
+        }
+        double ecmSec = s1 + s2;
+        json << (threads > 1 ? "," : "") << "{\"threads\":" << threads
+             << ",\"wall_s\":" << wall << ",\"curves\":" << totalCurves
+             << ",\"curves_per_sec\":" << (ecmSec > 0 ? totalCurves * threads / ecmSec : 0)
+             << ",\"stage1_s\":" << s1 << ",\"stage2_s\":" << s2
+             << ",\"cheap_s\":" << cheap << ",\"siqs_s\":" << siqs << ",\"rows\":[";
+        for (unsigned r = 0; r < rows; r++)
+        {
+            std::vector<double> t(sec.begin() + r * perRow,
+                                  sec.begin() + (r + 1) * perRow);
+            unsigned factored = 0;
+            json << (r ? "," : "") << "{\"digits\":" << kBenchRows[r].digits
+                 << ",\"factor_digits\":" << kBenchRows[r].factorDigits
+                 << ",\"median_s\":" << percentile(t, 50) << ",\"p90_s\":"
+                 << percentile(t, 90) << ",\"times_s\":[";
+            for (unsigned i = 0; i < perRow; i++)
+            {
+                json << (i ? "," : "") << t[i];
+                factored += ok[r * perRow + i];
+            }
+            json << "],\"curves\":[";
+            for (unsigned i = 0; i < perRow; i++)
+                json << (i ? "," : "") << curves[r * perRow + i];
+            json << "],\"factored\":" << factored << "}";
+            std::cerr << "  t=" << threads << " C" << kBenchRows[r].digits << " (p"
+                      << kBenchRows[r].factorDigits << "): median "
+                      << percentile(t, 50) << " s, p90 " << percentile(t, 90)
+                      << " s, " << factored << "/" << perRow << " factored\n";
+        }
+        json << "]}";
+        std::cerr << "  t=" << threads << ": " << wall << " s, stage1 " << s1
+                  << " s, stage2 " << s2 << " s, cheap " << cheap << " s, SIQS "
+                  << siqs << " s\n";
+        if (threads == maxThreads) break;
+    }
+    json << "]}\n";
+
+    if (std::strcmp(jsonPath, "-"))
+    {
+        std::ofstream out(jsonPath);
+        out << json.str();
+        if (!out)
+        {
+            std::cerr << "cannot write " << jsonPath << "\n";
+            return 1;
+        }
     }
+    else
+    {
+        std::cout << json.str();
+    }
+    return 0;
+}
+
+static void usage(const char* prog)
+{
+    std::cerr << "usage: " << prog
+              << " [N] [-t threads] [-d maxDigits] [-s sigmaBase] [-q]\n"
+              << "       " << prog
+              << " -b file|- [-t threads] [-d maxDigits] [-s sigmaBase] [-v]\n"
+              << "  -g           batch mode: batch GCD over all lines before any ECM\n"
+              << "  -L addr      also serve units to remote workers (-t 0: only them)\n"
+              << "  -W addr      run as a worker for the coordinator at addr\n"
+              << "               addr is a Unix socket path or host:port for TCP\n"
+              << "  -B file|-    benchmark: seeded corpus at 1, 2, 4.. -t threads, JSON out\n"
+              << "  -R count     benchmark numbers per corpus row (default 10)\n"
+              << "  -Q digits    largest cofactor handed to SIQS (default 100, 0 = off)\n"
+              << "  -E           GMP-ECM for stage 1 too, even below 2^256\n"
+              << "  -X           cross-check every in-house stage 1 with GMP-ECM's\n"
+              << "  -k file      checkpoint state file; resumed from if present\n"
+              << "  -K seconds   checkpoint interval (default 60)\n"
+              << "  -T seconds   telemetry report to stderr every so often\n"
+              << "  -J file|-    telemetry as JSON lines (interval -T, default 10)\n";
+}
+
+int main(int argc, char** argv)
+{
+    const char* nArg = N_str;
+    unsigned numThreads = std::thread::hardware_concurrency();
+    if (numThreads == 0) numThreads = 4;
+    unsigned long sigmaBase = 0;
+    const char* batchPath = nullptr;
+    bool verboseSet = false;
+    bool nGiven = false;
+    bool sharedFactors = false;
+    const char* listenSpec = nullptr;
+    const char* workerSpec = nullptr;
+    const char* benchPath = nullptr;
+    unsigned benchPerRow = kBenchDefaultPerRow;
+    std::string checkpointPath;
+    unsigned checkpointInterval = 60;
+    unsigned telemetryInterval = 0;
+    const char* jsonPath = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (!std::strcmp(argv[i], "-t") && hasValue)
+            numThreads = std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "-d") && hasValue)
+            g_sched.maxDigits = std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "-Q") && hasValue)
+            g_sched.maxSiqsDigits = std::min<unsigned long>(
+                kSiqsMaxDigits, std::strtoul(argv[++i], nullptr, 10));
+        else if (!std::strcmp(argv[i], "-s") && hasValue)
+            sigmaBase = std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "-b") && hasValue)
+            batchPath = argv[++i];
+        else if (!std::strcmp(argv[i], "-k") && hasValue)
+            checkpointPath = argv[++i];
+        else if (!std::strcmp(argv[i], "-K") && hasValue)
+            checkpointInterval = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+        else if (!std::strcmp(argv[i], "-T") && hasValue)
+            telemetryInterval = std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "-J") && hasValue)
+            jsonPath = argv[++i];
+        else if (!std::strcmp(argv[i], "-L") && hasValue)
+            listenSpec = argv[++i];
+        else if (!std::strcmp(argv[i], "-W") && hasValue)
+            workerSpec = argv[++i];
+        else if (!std::strcmp(argv[i], "-B") && hasValue)
+            benchPath = argv[++i];
+        else if (!std::strcmp(argv[i], "-R") && hasValue)
+            benchPerRow = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+        else if (!std::strcmp(argv[i], "-g"))
+            sharedFactors = true;
+        else if (!std::strcmp(argv[i], "-E"))
+            g_edwards = false;
+        else if (!std::strcmp(argv[i], "-X"))
+            g_edwardsCheck = true;
+        else if (!std::strcmp(argv[i], "-q") || !std::strcmp(argv[i], "-v"))
+        {
+            g_verbose = argv[i][1] == 'v';
+            verboseSet = true;
+        }
+        else if (argv[i][0] != '-')
+        {
+            nArg = argv[i];
+            nGiven = true;
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (numThreads == 0 && !listenSpec) numThreads = 1;
+    if (workerSpec) return runRemoteWorker(workerSpec, std::max(1u, numThreads));
+    g_threadStats.reset(new ThreadStats[numThreads]);
+    g_numThreadStats = numThreads;
+
+    // Suyama's parametrization needs sigma >= 6; a random base keeps separate
+    // runs on different curves unless -s pins it (the benchmark pins it).
+    if (benchPath && sigmaBase < 6)
+        sigmaBase = kBenchSigmaBase;
+    if (sigmaBase < 6)
+    {
+        std::random_device rd;
+        sigmaBase = 6 + (rd() & 0x3fffffff);
+    }
+    g_sched.sigmaBase = sigmaBase;
+    if ((batchPath || benchPath) && !verboseSet)
+        g_verbose = false;   // per-curve logging drowns the result lines
+    if (benchPath)
+        return runBench(benchPath, numThreads, benchPerRow);
+
+    // A checkpoint's sigma base and job numbering win over -s, so resumed
+    // jobs keep their sigma blocks and new jobs never collide with them.
+    std::vector<Input*> restored;
+    std::vector<unsigned long> finishedIds;
+    std::atomic_bool finished(false);
+    std::thread checkpointer;
+    if (!checkpointPath.empty())
+    {
+        resumeCheckpoint(checkpointPath, restored, finishedIds);
+        std::signal(SIGINT, onTerminate);
+        std::signal(SIGTERM, onTerminate);
+        checkpointer = std::thread(checkpointLoop, std::cref(checkpointPath),
+                                   checkpointInterval, std::cref(finished));
+    }
+
+    std::ofstream jsonFile;
+    std::ostream* json = nullptr;
+    if (jsonPath)
+    {
+        if (std::strcmp(jsonPath, "-"))
+        {
+            jsonFile.open(jsonPath, std::ios::app);
+            json = &jsonFile;
+        }
+        else
+        {
+            json = &std::cout;
+        }
+        if (telemetryInterval == 0) telemetryInterval = 10;
+    }
+    std::unique_ptr<Telemetry> telemetry;
+    std::thread reporter;
+    if (telemetryInterval)
+    {
+        telemetry.reset(new Telemetry(json, true));
+        reporter = std::thread(telemetryLoop, std::ref(*telemetry),
+                               telemetryInterval, std::cref(finished));
+    }
+
+    // Stops the background threads and leaves a final report and checkpoint.
+    std::thread acceptor;
+    auto stopBackground = [&] {
+        finished = true;
+        if (acceptor.joinable())
+        {
+            g_acceptorStop = true;
+            acceptor.join();
+        }
+        if (g_edwardsCheck)
+            std::cerr << "stage 1 cross-check: " << g_edwardsMismatches.load()
+                      << " mismatch(es) against GMP-ECM\n";
+        if (reporter.joinable())
+        {
+            reporter.join();
+            telemetry->report();
+        }
+        if (checkpointer.joinable())
+        {
+            checkpointer.join();
+            if (!writeCheckpoint(checkpointPath))
+                std::cerr << "warning: cannot write checkpoint " << checkpointPath << "\n";
+        }
+    };
+
+    if (batchPath)
+    {
+        if (listenSpec && !startCoordinator(listenSpec, acceptor))
+        {
+            stopBackground();
+            return 1;
+        }
+        int rc = runBatch(batchPath, numThreads, restored, finishedIds,
+                          sharedFactors);
+        stopBackground();
+        return rc;
+    }
+
+    Input* resumed = nullptr;
+    for (Input* r : restored)
+    {
+        if (!nGiven || r->n == mpz_class(nArg)) resumed = r;
+    }
+    if (!restored.empty() && (!resumed || restored.size() > 1))
+    {
+        std::cerr << "checkpoint " << checkpointPath
+                  << " does not belong to this single-number run\n";
+        return 1;
+    }
+
+    Input fresh;
+    Input& in = resumed ? *resumed : fresh;
+    if (!resumed) in.n = mpz_class(nArg);
+    in.id = 1;
+    std::cout << "Factoring with GMP-ECM.\n";
+    std::cout << "N = " << in.n.get_str() << "\n";
+    std::cout << "Using " << numThreads << " threads, sigma base "
+              << g_sched.sigmaBase << ".\n\n";
+
+    if (listenSpec && !startCoordinator(listenSpec, acceptor))
+    {
+        stopBackground();
+        return 1;
+    }
+    if (!resumed) g_sched.submit(&in);
+    g_sched.close();
+
+    std::vector<std::thread> threads;
+    startWorkers(threads, numThreads);
+
+    // with -L -t 0 there may be no local thread to wait for
+    std::vector<Input*> done;
+    while (g_sched.waitFinished(done)) {}
+    for (auto &th : threads) {
+        if (th.joinable()) th.join();
+    }
+    stopBackground();
+
+    auto end = std::chrono::steady_clock::now();
+    double elapsedSec = std::chrono::duration<double>(end - in.start).count();
 
-    mpz_class f2 = N / f1;
-    if (f1 > f2) std::swap(f1, f2);
+    std::cout << "\nN = " << formatFactorization(in) << "\n";
 
-    std::cout << "\nFactor found!\n";
-    std::cout << "  f1 = " << f1.get_str() << "\n";
-    std::cout << "  f2 = " << f2.get_str() << "\n";
-    if ((f1 * f2) == N) {
-        std::cout << "Verification: f1 * f2 == N. Good!\n";
+    mpz_class product = 1;
+    for (const mpz_class& p : in.primes) product *= p;
+    for (const mpz_class& c : in.composites) product *= c;
+    if (product == in.n) {
+        std::cout << "Verification: product of factors == N. Good!\n";
     } else {
         std::cout << "ERROR: Product mismatch.\n";
     }
+    if (!in.composites.empty())
+        std::cout << in.composites.size()
+                  << " composite cofactor(s) survived the ECM ladder.\n";
 
+    std::cout << in.curves << " ECM curves.\n";
     std::cout << "Time elapsed: " << elapsedSec << " seconds.\n";
+    delete resumed;
     return 0;
 }